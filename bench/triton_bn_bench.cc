@@ -0,0 +1,703 @@
+// End-to-end benchmark of the basic block simplification pipeline, run over a
+// versioned corpus of obfuscated basic blocks (see `corpus/`). CFG recovery and
+// basic block merging are also measured on large synthetic functions.
+//
+// Usage: triton_bn_bench [--corpus <dir>] [--iterations <n>]
+//                        [--cfg-instructions <n>] [--merge-blocks <n>]
+//                        [--output <path>]
+//
+// A summary is printed to the standard output and, if requested, results are
+// written as JSON so that they can be compared between releases.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <triton/context.hpp>
+#include <vector>
+
+#include "core/arch_traits.h"
+#include "core/basic_block_simplifier.h"
+#include "core/cfg_builder.h"
+#include "core/code_source.h"
+#include "core/instrumentation.h"
+#include "core/meta_basic_block.h"
+#include "core/nop_verdict_cache.h"
+
+#ifndef TRITON_BN_BENCH_CORPUS_DIR
+#define TRITON_BN_BENCH_CORPUS_DIR "corpus/v1"
+#endif
+
+// Version of the JSON output's layout
+constexpr int kResultSchemaVersion = 1;
+constexpr size_t kDefaultIterationCount = 100;
+constexpr size_t kDefaultCfgInstructionCount = 100000;
+constexpr size_t kDefaultMergeBlockCount = 100000;
+constexpr size_t kDefaultPreviewInstructionCount = 100000;
+// Time within which previews should be displayed, in milliseconds
+constexpr double kPreviewTargetMs = 100;
+
+struct CorpusEntry {
+  std::string name;
+  std::string architecture_name;
+  triton::arch::architecture_e architecture = triton::arch::ARCH_INVALID;
+  uint64_t address = 0;
+  std::vector<uint8_t> data{};
+};
+
+struct LatencyStatistics {
+  double p50_us = 0;
+  double p90_us = 0;
+  double p99_us = 0;
+  double max_us = 0;
+};
+
+struct BenchmarkResult {
+  const CorpusEntry* entry = nullptr;
+  std::string error{};
+  size_t instruction_count_in = 0;
+  size_t instruction_count_out = 0;
+  size_t byte_count_in = 0;
+  size_t byte_count_out = 0;
+  // Duration of each run, in microseconds
+  std::vector<double> latencies_us{};
+};
+
+struct CfgRecoveryResult {
+  size_t instruction_count = 0;
+  size_t basic_block_count = 0;
+  double time_ms = 0;
+};
+
+struct MergeResult {
+  size_t basic_block_count = 0;
+  double time_ms = 0;
+};
+
+struct PreviewResult {
+  size_t instruction_count = 0;
+  // Instructions left by the quick simplification
+  size_t instruction_count_out = 0;
+  size_t basic_block_count = 0;
+  double time_ms = 0;
+};
+
+static bool LoadCorpus(const std::filesystem::path& corpus_dir,
+                       std::vector<CorpusEntry>& entries);
+static bool DisassembleCorpusEntry(const CorpusEntry& entry,
+                                   triton::arch::BasicBlock& triton_bb,
+                                   std::string& error);
+static BenchmarkResult RunBenchmark(const CorpusEntry& entry,
+                                    size_t iteration_count);
+static void BuildSyntheticFunction(size_t instruction_count,
+                                   std::vector<uint8_t>& code,
+                                   size_t& actual_instruction_count);
+static CfgRecoveryResult RunCfgRecoveryBenchmark(size_t instruction_count);
+static PreviewResult RunPreviewBenchmark(size_t instruction_count);
+static std::vector<MergeResult> RunMergeBenchmark(size_t max_block_count);
+static MergeResult RunMergeBenchmarkOnChain(
+    size_t block_count, const triton::arch::Instruction& template_instr);
+static LatencyStatistics ComputeLatencyStatistics(
+    std::vector<double> latencies_us);
+static double ComputeReductionRatio(size_t count_in, size_t count_out);
+static double ComputeThroughput(size_t instruction_count,
+                                const std::vector<double>& latencies_us);
+static void PrintSummary(const std::vector<BenchmarkResult>& results,
+                         const CfgRecoveryResult& cfg_recovery_result,
+                         const std::vector<MergeResult>& merge_results,
+                         const PreviewResult& preview_result);
+static std::string GenerateJson(const std::string& corpus_version,
+                                size_t iteration_count,
+                                const std::vector<BenchmarkResult>& results,
+                                const CfgRecoveryResult& cfg_recovery_result,
+                                const std::vector<MergeResult>& merge_results,
+                                const PreviewResult& preview_result);
+static std::string EscapeJsonString(const std::string& str);
+static void AppendLatencyJson(std::ostringstream& json,
+                              const std::vector<double>& latencies_us);
+
+int main(int argc, char* argv[]) {
+  std::filesystem::path corpus_dir = TRITON_BN_BENCH_CORPUS_DIR;
+  size_t iteration_count = kDefaultIterationCount;
+  size_t cfg_instruction_count = kDefaultCfgInstructionCount;
+  size_t merge_block_count = kDefaultMergeBlockCount;
+  size_t preview_instruction_count = kDefaultPreviewInstructionCount;
+  std::string output_path{};
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) {
+      corpus_dir = argv[++i];
+    } else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iteration_count = std::max(1UL, std::strtoul(argv[++i], nullptr, 0));
+    } else if (std::strcmp(argv[i], "--cfg-instructions") == 0 &&
+               i + 1 < argc) {
+      cfg_instruction_count = std::strtoul(argv[++i], nullptr, 0);
+    } else if (std::strcmp(argv[i], "--merge-blocks") == 0 && i + 1 < argc) {
+      merge_block_count = std::strtoul(argv[++i], nullptr, 0);
+    } else if (std::strcmp(argv[i], "--preview-instructions") == 0 &&
+               i + 1 < argc) {
+      preview_instruction_count = std::strtoul(argv[++i], nullptr, 0);
+    } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      output_path = argv[++i];
+    } else {
+      std::fprintf(stderr,
+                   "Usage: %s [--corpus <dir>] [--iterations <n>] "
+                   "[--cfg-instructions <n>] [--merge-blocks <n>] "
+                   "[--preview-instructions <n>] [--output <path>]\n",
+                   argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::vector<CorpusEntry> entries{};
+  if (!LoadCorpus(corpus_dir, entries)) {
+    return EXIT_FAILURE;
+  }
+
+  // Note: Per-stage timings are included in the results
+  triton_bn::Instrumentation::Instance().SetEnabled(true);
+
+  std::vector<BenchmarkResult> results{};
+  bool failed = false;
+  for (const auto& entry : entries) {
+    results.emplace_back(RunBenchmark(entry, iteration_count));
+    failed |= !results.back().error.empty();
+  }
+  // Note: A count of 0 disables these benchmarks
+  CfgRecoveryResult cfg_recovery_result{};
+  if (cfg_instruction_count > 0) {
+    cfg_recovery_result = RunCfgRecoveryBenchmark(cfg_instruction_count);
+  }
+  std::vector<MergeResult> merge_results{};
+  if (merge_block_count > 0) {
+    merge_results = RunMergeBenchmark(merge_block_count);
+  }
+  PreviewResult preview_result{};
+  if (preview_instruction_count > 0) {
+    preview_result = RunPreviewBenchmark(preview_instruction_count);
+  }
+  PrintSummary(results, cfg_recovery_result, merge_results, preview_result);
+
+  if (!output_path.empty()) {
+    // Note: The corpus version is the name of its directory (e.g., "v1")
+    const std::string corpus_version =
+        std::filesystem::absolute(corpus_dir / "")
+            .parent_path()
+            .filename()
+            .string();
+    std::ofstream output(output_path);
+    output << GenerateJson(corpus_version, iteration_count, results,
+                           cfg_recovery_result, merge_results, preview_result);
+    if (!output) {
+      std::fprintf(stderr, "Failed to write results to '%s'\n",
+                   output_path.c_str());
+      return EXIT_FAILURE;
+    }
+  }
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// Parse the corpus' manifest and load the associated blobs
+static bool LoadCorpus(const std::filesystem::path& corpus_dir,
+                       std::vector<CorpusEntry>& entries) {
+  const auto manifest_path = corpus_dir / "manifest.txt";
+  std::ifstream manifest(manifest_path);
+  if (!manifest) {
+    std::fprintf(stderr, "Failed to open '%s'\n",
+                 manifest_path.string().c_str());
+    return false;
+  }
+
+  std::string line{};
+  size_t line_number = 0;
+  while (std::getline(manifest, line)) {
+    line_number++;
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    // Format: <name> <architecture> <address> <blob>
+    std::istringstream line_stream(line);
+    CorpusEntry entry{};
+    std::string address{};
+    std::string blob_name{};
+    if (!(line_stream >> entry.name >> entry.architecture_name >> address >>
+          blob_name)) {
+      std::fprintf(stderr, "Invalid corpus entry at line %zu\n", line_number);
+      return false;
+    }
+    entry.architecture =
+        triton_bn::ArchitectureFromName(entry.architecture_name);
+    if (entry.architecture == triton::arch::ARCH_INVALID) {
+      std::fprintf(stderr, "Unsupported architecture '%s' at line %zu\n",
+                   entry.architecture_name.c_str(), line_number);
+      return false;
+    }
+    entry.address = std::strtoull(address.c_str(), nullptr, 0);
+
+    std::ifstream blob(corpus_dir / blob_name, std::ios::binary);
+    if (!blob) {
+      std::fprintf(stderr, "Failed to open blob '%s'\n", blob_name.c_str());
+      return false;
+    }
+    entry.data.assign(std::istreambuf_iterator<char>(blob),
+                      std::istreambuf_iterator<char>());
+    entries.emplace_back(std::move(entry));
+  }
+
+  return true;
+}
+
+// Decode the corpus entry's blob into a Triton basic block
+static bool DisassembleCorpusEntry(const CorpusEntry& entry,
+                                   triton::arch::BasicBlock& triton_bb,
+                                   std::string& error) {
+  constexpr size_t kMaxInstructionSize = 16;
+
+  triton::Context triton(entry.architecture);
+  size_t offset = 0;
+  while (offset < entry.data.size()) {
+    const uint64_t instr_addr = entry.address + offset;
+    const uint8_t* instr_data = &entry.data[offset];
+    const auto max_instr_size = static_cast<uint32_t>(
+        std::min(kMaxInstructionSize, entry.data.size() - offset));
+
+    // Note: The instruction's size is only known once it's been decoded
+    triton::arch::Instruction decoded_instr(instr_addr, instr_data,
+                                            max_instr_size);
+    try {
+      triton.disassembly(decoded_instr);
+    } catch (triton::exceptions::Exception& ex) {
+      error = "failed to disassemble instruction at offset " +
+              std::to_string(offset) + ": " + ex.what();
+      return false;
+    }
+    if (decoded_instr.getSize() == 0) {
+      error =
+          "failed to decode instruction at offset " + std::to_string(offset);
+      return false;
+    }
+
+    triton_bb.add(triton::arch::Instruction(instr_addr, instr_data,
+                                            decoded_instr.getSize()));
+    offset += decoded_instr.getSize();
+  }
+
+  return true;
+}
+
+// Simplify the given corpus entry `iteration_count` times
+static BenchmarkResult RunBenchmark(const CorpusEntry& entry,
+                                    size_t iteration_count) {
+  BenchmarkResult result{};
+  result.entry = &entry;
+  result.byte_count_in = entry.data.size();
+
+  triton::arch::BasicBlock triton_bb{};
+  if (!DisassembleCorpusEntry(entry, triton_bb, result.error)) {
+    return result;
+  }
+  result.instruction_count_in = triton_bb.getSize();
+
+  triton::Context triton(entry.architecture);
+  for (size_t i = 0; i < iteration_count; i++) {
+    // Note: Verdicts are dropped so that every run goes through the whole
+    // pipeline, and runs can be compared with one another
+    triton_bn::NopVerdictCache::Instance().Clear();
+
+    const auto start_time = std::chrono::steady_clock::now();
+    triton::arch::BasicBlock simplified_bb{};
+    try {
+      simplified_bb = triton_bn::SimplifyTritonBasicBlock(
+          triton, triton_bb, entry.address, false);
+    } catch (triton::exceptions::Exception& ex) {
+      result.error = std::string("failed to simplify basic block: ") +
+                     ex.what();
+      return result;
+    }
+    const auto end_time = std::chrono::steady_clock::now();
+    result.latencies_us.push_back(
+        std::chrono::duration<double, std::micro>(end_time - start_time)
+            .count());
+
+    // Note: The output is the same for every run
+    result.instruction_count_out = simplified_bb.getSize();
+    result.byte_count_out = 0;
+    for (const auto& instr : simplified_bb.getInstructions()) {
+      result.byte_count_out += instr.getSize();
+    }
+  }
+
+  return result;
+}
+
+// Build the code of a synthetic x86-64 function made of about
+// `instruction_count` instructions, with a conditional branch every five
+// instructions. Each branch is preceded by a comparison whose flags are
+// overwritten before being read.
+static void BuildSyntheticFunction(size_t instruction_count,
+                                   std::vector<uint8_t>& code,
+                                   size_t& actual_instruction_count) {
+  // inc rax; cmp rax, rcx; test rax, rax; je +3; dec rax
+  constexpr uint8_t kPattern[] = {0x48, 0xff, 0xc0, 0x48, 0x39, 0xc8, 0x48,
+                                  0x85, 0xc0, 0x74, 0x03, 0x48, 0xff, 0xc8};
+  constexpr size_t kPatternInstructionCount = 5;
+  constexpr uint8_t kRet = 0xc3;
+
+  const size_t pattern_count =
+      std::max<size_t>(1, instruction_count / kPatternInstructionCount);
+  code.clear();
+  for (size_t i = 0; i < pattern_count; i++) {
+    code.insert(std::end(code), std::begin(kPattern), std::end(kPattern));
+  }
+  code.push_back(kRet);
+  actual_instruction_count = pattern_count * kPatternInstructionCount + 1;
+}
+
+// Recover the CFG of a synthetic function, see `BuildSyntheticFunction`
+static CfgRecoveryResult RunCfgRecoveryBenchmark(size_t instruction_count) {
+  constexpr uint64_t kFunctionStart = 0x140001000;
+
+  CfgRecoveryResult result{};
+  std::vector<uint8_t> code{};
+  BuildSyntheticFunction(instruction_count, code, result.instruction_count);
+  triton_bn::MemoryCodeSource code_source{};
+  code_source.AddRange(kFunctionStart, code.data(), code.size());
+
+  triton::Context triton(triton::arch::ARCH_X86_64);
+  const auto start_time = std::chrono::steady_clock::now();
+  const auto cfg =
+      triton_bn::RecoverControlFlowGraph(code_source, kFunctionStart, triton);
+  const auto end_time = std::chrono::steady_clock::now();
+  result.basic_block_count = cfg.block_count();
+  result.time_ms =
+      std::chrono::duration<double, std::milli>(end_time - start_time).count();
+
+  return result;
+}
+
+// Time what a progressive preview does before its first graph is displayed
+// (extraction, merging and the quick simplification), on a synthetic function
+// whose CFG is already known. The NOP-like verdict cache is emptied
+// beforehand, as for a function displayed for the first time, so only what the
+// quick pass finds by itself is removed.
+// Note: Building the flow graph itself requires "Binary Ninja", it isn't
+// included
+static PreviewResult RunPreviewBenchmark(size_t instruction_count) {
+  constexpr uint64_t kFunctionStart = 0x140001000;
+
+  PreviewResult result{};
+  std::vector<uint8_t> code{};
+  BuildSyntheticFunction(instruction_count, code, result.instruction_count);
+  triton_bn::MemoryCodeSource code_source{};
+  code_source.AddRange(kFunctionStart, code.data(), code.size());
+  triton::Context triton(triton::arch::ARCH_X86_64);
+  const auto cfg =
+      triton_bn::RecoverControlFlowGraph(code_source, kFunctionStart, triton);
+  result.basic_block_count = cfg.block_count();
+  triton_bn::NopVerdictCache::Instance().Clear();
+
+  triton_bn::SimplificationOptions options{};
+  options.quick = true;
+  const auto start_time = std::chrono::steady_clock::now();
+  auto basic_blocks =
+      triton_bn::ExtractMetaBasicBlocksFromFunction(code_source, cfg, triton);
+  basic_blocks = triton_bn::MergeMetaBasicBlocks(cfg, std::move(basic_blocks));
+  const auto quick_basic_blocks = triton_bn::SimplifyMetaBasicBlocks(
+      triton, std::move(basic_blocks), options);
+  const auto end_time = std::chrono::steady_clock::now();
+  result.time_ms =
+      std::chrono::duration<double, std::milli>(end_time - start_time).count();
+  for (const auto& meta_bb : quick_basic_blocks) {
+    result.instruction_count_out += meta_bb.triton_bb().getSize();
+  }
+
+  return result;
+}
+
+// Merge synthetic chains of basic blocks of increasing sizes, up to
+// `max_block_count`. Merging is linear in the number of basic blocks, so the
+// time per basic block should stay flat.
+static std::vector<MergeResult> RunMergeBenchmark(size_t max_block_count) {
+  // inc rax
+  constexpr uint8_t kInstruction[] = {0x48, 0xff, 0xc0};
+  constexpr size_t kStepCount = 4;
+
+  triton::Context triton(triton::arch::ARCH_X86_64);
+  triton::arch::Instruction template_instr(kInstruction, sizeof(kInstruction));
+  triton.disassembly(template_instr);
+
+  std::vector<MergeResult> results{};
+  for (size_t step = kStepCount; step > 0; step--) {
+    const size_t block_count =
+        std::max<size_t>(1, max_block_count >> (step - 1));
+    results.push_back(RunMergeBenchmarkOnChain(block_count, template_instr));
+  }
+  return results;
+}
+
+// Each basic block of the chain holds a single instruction and falls through
+// into the next one, so that the whole chain is merged into a single basic
+// block
+static MergeResult RunMergeBenchmarkOnChain(
+    size_t block_count, const triton::arch::Instruction& template_instr) {
+  constexpr uint64_t kFunctionStart = 0x140001000;
+
+  triton_bn::ControlFlowGraph cfg{};
+  cfg.function_start = kFunctionStart;
+  cfg.Reserve(block_count, block_count);
+  for (size_t i = 0; i < block_count; i++) {
+    const uint64_t start = kFunctionStart + i * template_instr.getSize();
+    cfg.AddBasicBlock(start, start + template_instr.getSize());
+    if (i + 1 < block_count) {
+      cfg.AddOutgoingEdge(triton_bn::BranchType::kUnconditional,
+                          static_cast<uint32_t>(i + 1));
+    }
+  }
+  triton_bn::CountIncomingEdges(cfg);
+
+  std::vector<triton_bn::MetaBasicBlock> basic_blocks{};
+  basic_blocks.reserve(block_count);
+  for (size_t i = 0; i < block_count; i++) {
+    triton::arch::Instruction instr = template_instr;
+    instr.setAddress(cfg.block_starts[i]);
+    triton::arch::BasicBlock triton_bb{};
+    triton_bb.add(instr);
+    basic_blocks.emplace_back(std::move(triton_bb), cfg,
+                              static_cast<uint32_t>(i));
+  }
+
+  const auto start_time = std::chrono::steady_clock::now();
+  const auto merged_basic_blocks =
+      triton_bn::MergeMetaBasicBlocks(cfg, std::move(basic_blocks));
+  const auto end_time = std::chrono::steady_clock::now();
+
+  MergeResult result{};
+  result.basic_block_count = block_count;
+  result.time_ms =
+      std::chrono::duration<double, std::milli>(end_time - start_time).count();
+  return result;
+}
+
+// Compute latency percentiles with the nearest-rank method
+static LatencyStatistics ComputeLatencyStatistics(
+    std::vector<double> latencies_us) {
+  LatencyStatistics statistics{};
+  if (latencies_us.empty()) {
+    return statistics;
+  }
+
+  std::sort(std::begin(latencies_us), std::end(latencies_us));
+  auto percentile = [&latencies_us](double p) {
+    const auto rank = static_cast<size_t>(p * latencies_us.size() + 0.5);
+    return latencies_us[std::clamp<size_t>(rank, 1, latencies_us.size()) - 1];
+  };
+  statistics.p50_us = percentile(0.50);
+  statistics.p90_us = percentile(0.90);
+  statistics.p99_us = percentile(0.99);
+  statistics.max_us = latencies_us.back();
+
+  return statistics;
+}
+
+// Ratio of the input that's been removed by the simplification
+static double ComputeReductionRatio(size_t count_in, size_t count_out) {
+  if (count_in == 0) {
+    return 0;
+  }
+  return 1.0 - static_cast<double>(count_out) / static_cast<double>(count_in);
+}
+
+// Number of input instructions processed per second
+static double ComputeThroughput(size_t instruction_count,
+                                const std::vector<double>& latencies_us) {
+  double total_time_us = 0;
+  for (const double latency_us : latencies_us) {
+    total_time_us += latency_us;
+  }
+  if (total_time_us == 0) {
+    return 0;
+  }
+  return static_cast<double>(instruction_count * latencies_us.size()) /
+         (total_time_us / 1e6);
+}
+
+static void PrintSummary(const std::vector<BenchmarkResult>& results,
+                         const CfgRecoveryResult& cfg_recovery_result,
+                         const std::vector<MergeResult>& merge_results,
+                         const PreviewResult& preview_result) {
+  std::printf("%-28s %8s %8s %10s %10s %10s %12s\n", "block", "instr", "ratio",
+              "p50 (us)", "p90 (us)", "p99 (us)", "instr/s");
+  for (const auto& result : results) {
+    if (!result.error.empty()) {
+      std::printf("%-28s error: %s\n", result.entry->name.c_str(),
+                  result.error.c_str());
+      continue;
+    }
+
+    const auto latency = ComputeLatencyStatistics(result.latencies_us);
+    std::printf("%-28s %3zu->%-4zu %8.3f %10.1f %10.1f %10.1f %12.0f\n",
+                result.entry->name.c_str(), result.instruction_count_in,
+                result.instruction_count_out,
+                ComputeReductionRatio(result.instruction_count_in,
+                                      result.instruction_count_out),
+                latency.p50_us, latency.p90_us, latency.p99_us,
+                ComputeThroughput(result.instruction_count_in,
+                                  result.latencies_us));
+  }
+
+  if (cfg_recovery_result.instruction_count > 0) {
+    std::printf("\nCFG recovery: %zu instruction(s), %zu basic block(s) in "
+                "%.1f ms\n",
+                cfg_recovery_result.instruction_count,
+                cfg_recovery_result.basic_block_count,
+                cfg_recovery_result.time_ms);
+  }
+  for (const MergeResult& merge_result : merge_results) {
+    std::printf("Merge: %zu basic block(s) in %.1f ms (%.0f ns/block)\n",
+                merge_result.basic_block_count, merge_result.time_ms,
+                merge_result.time_ms * 1e6 /
+                    static_cast<double>(merge_result.basic_block_count));
+  }
+  if (preview_result.instruction_count > 0) {
+    std::printf("Preview: %zu instruction(s), %zu basic block(s) in %.1f ms "
+                "(target: %.0f ms), %zu instruction(s) left\n",
+                preview_result.instruction_count,
+                preview_result.basic_block_count, preview_result.time_ms,
+                kPreviewTargetMs, preview_result.instruction_count_out);
+  }
+}
+
+static std::string EscapeJsonString(const std::string& str) {
+  std::string escaped{};
+  for (const char c : str) {
+    switch (c) {
+      case '"':
+        escaped += "\\\"";
+        break;
+      case '\\':
+        escaped += "\\\\";
+        break;
+      case '\n':
+        escaped += "\\n";
+        break;
+      default:
+        escaped += c;
+        break;
+    }
+  }
+  return escaped;
+}
+
+static void AppendLatencyJson(std::ostringstream& json,
+                              const std::vector<double>& latencies_us) {
+  const auto latency = ComputeLatencyStatistics(latencies_us);
+  json << "{\"p50\": " << latency.p50_us << ", \"p90\": " << latency.p90_us
+       << ", \"p99\": " << latency.p99_us << ", \"max\": " << latency.max_us
+       << "}";
+}
+
+// Note: Blocks are listed in corpus order and keys are always emitted in the
+// same order, which keeps the output diff-friendly
+static std::string GenerateJson(const std::string& corpus_version,
+                                size_t iteration_count,
+                                const std::vector<BenchmarkResult>& results,
+                                const CfgRecoveryResult& cfg_recovery_result,
+                                const std::vector<MergeResult>& merge_results,
+                                const PreviewResult& preview_result) {
+  std::ostringstream json{};
+  json.precision(6);
+
+  size_t total_instruction_count_in = 0;
+  size_t total_instruction_count_out = 0;
+  std::vector<double> all_latencies_us{};
+  double total_time_us = 0;
+  double total_processed_instruction_count = 0;
+
+  json << "{\n";
+  json << "  \"schema_version\": " << kResultSchemaVersion << ",\n";
+  json << "  \"corpus_version\": \"" << EscapeJsonString(corpus_version)
+       << "\",\n";
+  json << "  \"iterations\": " << iteration_count << ",\n";
+  json << "  \"blocks\": [";
+  for (size_t i = 0; i < results.size(); i++) {
+    const BenchmarkResult& result = results[i];
+    const CorpusEntry& entry = *result.entry;
+    json << (i == 0 ? "\n" : ",\n");
+    json << "    {\"name\": \"" << EscapeJsonString(entry.name) << "\", "
+         << "\"architecture\": \""
+         << EscapeJsonString(entry.architecture_name) << "\", "
+         << "\"address\": " << entry.address << ", ";
+    if (!result.error.empty()) {
+      json << "\"error\": \"" << EscapeJsonString(result.error) << "\"}";
+      continue;
+    }
+
+    json << "\"instructions_in\": " << result.instruction_count_in << ", "
+         << "\"instructions_out\": " << result.instruction_count_out << ", "
+         << "\"bytes_in\": " << result.byte_count_in << ", "
+         << "\"bytes_out\": " << result.byte_count_out << ", "
+         << "\"reduction_ratio\": "
+         << ComputeReductionRatio(result.instruction_count_in,
+                                  result.instruction_count_out)
+         << ", "
+         << "\"instructions_per_second\": "
+         << ComputeThroughput(result.instruction_count_in,
+                              result.latencies_us)
+         << ", \"latency_us\": ";
+    AppendLatencyJson(json, result.latencies_us);
+    json << "}";
+
+    total_instruction_count_in += result.instruction_count_in;
+    total_instruction_count_out += result.instruction_count_out;
+    for (const double latency_us : result.latencies_us) {
+      total_time_us += latency_us;
+    }
+    total_processed_instruction_count += static_cast<double>(
+        result.instruction_count_in * result.latencies_us.size());
+    std::copy(std::cbegin(result.latencies_us), std::cend(result.latencies_us),
+              std::back_inserter(all_latencies_us));
+  }
+  json << "\n  ],\n";
+
+  json << "  \"summary\": {\"instructions_in\": " << total_instruction_count_in
+       << ", \"instructions_out\": " << total_instruction_count_out
+       << ", \"reduction_ratio\": "
+       << ComputeReductionRatio(total_instruction_count_in,
+                                total_instruction_count_out)
+       << ", \"instructions_per_second\": "
+       << (total_time_us > 0
+               ? total_processed_instruction_count / (total_time_us / 1e6)
+               : 0)
+       << ", \"latency_us\": ";
+  AppendLatencyJson(json, all_latencies_us);
+  json << "},\n";
+  json << "  \"cfg_recovery\": {\"instructions\": "
+       << cfg_recovery_result.instruction_count
+       << ", \"basic_blocks\": " << cfg_recovery_result.basic_block_count
+       << ", \"time_ms\": " << cfg_recovery_result.time_ms << "},\n";
+  json << "  \"merge\": [";
+  for (size_t i = 0; i < merge_results.size(); i++) {
+    json << (i == 0 ? "" : ", ") << "{\"basic_blocks\": "
+         << merge_results[i].basic_block_count
+         << ", \"time_ms\": " << merge_results[i].time_ms << "}";
+  }
+  json << "],\n";
+  json << "  \"preview\": {\"instructions\": "
+       << preview_result.instruction_count
+       << ", \"instructions_out\": " << preview_result.instruction_count_out
+       << ", \"basic_blocks\": " << preview_result.basic_block_count
+       << ", \"time_ms\": " << preview_result.time_ms
+       << ", \"target_ms\": " << kPreviewTargetMs << "},\n";
+  json << "  \"instrumentation\": "
+       << triton_bn::Instrumentation::Instance().GenerateJson() << "\n";
+  json << "}\n";
+
+  return json.str();
+}
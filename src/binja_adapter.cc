@@ -0,0 +1,225 @@
+#include "binja_adapter.h"
+
+#include <string>
+#include <triton/context.hpp>
+#include <unordered_map>
+#include <vector>
+
+#include "core/log.h"
+
+namespace triton_bn {
+
+using namespace BinaryNinja;
+
+static BranchType FromBinjaBranchType(BNBranchType type);
+static void BinjaLogSink(LogLevel level, const char* message);
+static bool ToTritonRegister(const triton::Context& triton,
+                             const std::string& reg_name,
+                             triton::arch::register_e& reg_id);
+
+ControlFlowGraph SnapshotFunctionCfg(Function& function) {
+  ControlFlowGraph cfg{};
+  cfg.function_start = function.GetStart();
+
+  const auto basic_blocks = function.GetBasicBlocks();
+  // "Binary Ninja" index -> CFG index
+  std::unordered_map<size_t, uint32_t> cfg_indexes{};
+  for (size_t i = 0; i < basic_blocks.size(); i++) {
+    cfg_indexes[basic_blocks[i]->GetIndex()] = static_cast<uint32_t>(i);
+  }
+
+  // Note: Edges are queried once per basic block, that's the only time "Binary
+  // Ninja" objects are accessed
+  std::vector<std::vector<BasicBlockEdge>> outgoing_edges(basic_blocks.size());
+  size_t edge_count = 0;
+  for (size_t i = 0; i < basic_blocks.size(); i++) {
+    outgoing_edges[i] = basic_blocks[i]->GetOutgoingEdges();
+    edge_count += outgoing_edges[i].size();
+  }
+
+  cfg.Reserve(basic_blocks.size(), edge_count);
+  for (size_t i = 0; i < basic_blocks.size(); i++) {
+    cfg.AddBasicBlock(basic_blocks[i]->GetStart(), basic_blocks[i]->GetEnd());
+    for (const BasicBlockEdge& edge : outgoing_edges[i]) {
+      uint32_t target = kInvalidBlockIndex;
+      if (edge.target.GetPtr() != nullptr) {
+        const auto it = cfg_indexes.find(edge.target->GetIndex());
+        if (it != std::cend(cfg_indexes)) {
+          target = it->second;
+        }
+      }
+      cfg.AddOutgoingEdge(FromBinjaBranchType(edge.type), target);
+    }
+  }
+
+  // Note: Edges all come from the function itself, so incoming edges can be
+  // counted from the outgoing ones
+  CountIncomingEdges(cfg);
+
+  return cfg;
+}
+
+ControlFlowGraph SnapshotBasicBlockCfg(BasicBlock& basic_block) {
+  ControlFlowGraph cfg{};
+  cfg.function_start = basic_block.GetFunction()->GetStart();
+
+  cfg.AddBasicBlock(basic_block.GetStart(), basic_block.GetEnd());
+  for (const BasicBlockEdge& edge : basic_block.GetOutgoingEdges()) {
+    cfg.AddOutgoingEdge(FromBinjaBranchType(edge.type));
+  }
+  cfg.incoming_edge_counts[0] =
+      static_cast<uint32_t>(basic_block.GetIncomingEdges().size());
+
+  return cfg;
+}
+
+bool MakeDefaultCallSummary(BinaryView& view,
+                            triton::arch::architecture_e triton_arch,
+                            CallSummary& call_summary) {
+  const Ref<Platform> platform = view.GetDefaultPlatform();
+  if (!platform) {
+    return false;
+  }
+  const Ref<CallingConvention> calling_convention =
+      platform->GetDefaultCallingConvention();
+  if (!calling_convention) {
+    return false;
+  }
+  const std::string calling_convention_name = calling_convention->GetName();
+  if (calling_convention->IsStackAdjustedOnReturn()) {
+    LogWarn("Calls can't be summarized with the '%s' calling convention",
+            calling_convention_name.c_str());
+    return false;
+  }
+
+  const Ref<Architecture> arch = view.GetDefaultArchitecture();
+  const triton::Context triton(triton_arch);
+  call_summary = {};
+
+  // Note: The integer return value register is an argument too, it holds the
+  // number of vector registers used by variadic calls on x86-64
+  std::vector<uint32_t> argument_registers =
+      calling_convention->GetIntegerArgumentRegisters();
+  for (const uint32_t reg : calling_convention->GetFloatArgumentRegisters()) {
+    argument_registers.push_back(reg);
+  }
+  argument_registers.push_back(
+      calling_convention->GetIntegerReturnValueRegister());
+  for (const uint32_t reg : argument_registers) {
+    const std::string reg_name = arch->GetRegisterName(reg);
+    triton::arch::register_e reg_id{};
+    // Note: Missing an argument would let stores it depends on be removed
+    if (!ToTritonRegister(triton, reg_name, reg_id)) {
+      LogWarn("Calls can't be summarized, unknown argument register '%s'",
+              reg_name.c_str());
+      return false;
+    }
+    call_summary.argument_registers.Insert(reg_id);
+  }
+
+  // Note: Unknown clobbered registers are considered preserved, which only
+  // keeps more instructions around
+  for (const uint32_t reg : calling_convention->GetCallerSavedRegisters()) {
+    triton::arch::register_e reg_id{};
+    if (ToTritonRegister(triton, arch->GetRegisterName(reg), reg_id)) {
+      call_summary.clobbered_registers.Insert(reg_id);
+    }
+  }
+  for (const auto* reg : triton.getParentRegisters()) {
+    if (triton.isFlag(reg->getId())) {
+      call_summary.clobbered_registers.Insert(reg->getId());
+    }
+  }
+
+  LogDebug("Calls summarized with the '%s' calling convention",
+           calling_convention_name.c_str());
+  return true;
+}
+
+// Find the parent register of the Triton register with the given name
+static bool ToTritonRegister(const triton::Context& triton,
+                             const std::string& reg_name,
+                             triton::arch::register_e& reg_id) {
+  try {
+    reg_id = triton.getParentRegister(triton.getRegister(reg_name)).getId();
+    return true;
+  } catch (triton::exceptions::Exception& ex) {
+    return false;
+  }
+}
+
+static BranchType FromBinjaBranchType(BNBranchType type) {
+  switch (type) {
+    case UnconditionalBranch:
+      return BranchType::kUnconditional;
+    case FalseBranch:
+      return BranchType::kFalse;
+    case TrueBranch:
+      return BranchType::kTrue;
+    case CallDestination:
+      return BranchType::kCall;
+    case FunctionReturn:
+      return BranchType::kReturn;
+    case SystemCall:
+      return BranchType::kSystemCall;
+    case IndirectBranch:
+      return BranchType::kIndirect;
+    case ExceptionBranch:
+      return BranchType::kException;
+    case UserDefinedBranch:
+      return BranchType::kUserDefined;
+    case UnresolvedBranch:
+    default:
+      return BranchType::kUnresolved;
+  }
+}
+
+BNBranchType ToBinjaBranchType(BranchType type) {
+  switch (type) {
+    case BranchType::kUnconditional:
+      return UnconditionalBranch;
+    case BranchType::kFalse:
+      return FalseBranch;
+    case BranchType::kTrue:
+      return TrueBranch;
+    case BranchType::kCall:
+      return CallDestination;
+    case BranchType::kReturn:
+      return FunctionReturn;
+    case BranchType::kSystemCall:
+      return SystemCall;
+    case BranchType::kIndirect:
+      return IndirectBranch;
+    case BranchType::kException:
+      return ExceptionBranch;
+    case BranchType::kUserDefined:
+      return UserDefinedBranch;
+    case BranchType::kUnresolved:
+    default:
+      return UnresolvedBranch;
+  }
+}
+
+void InstallBinjaLogSink() {
+  // Note: "Binary Ninja" filters messages by level itself
+  SetLogSink(BinjaLogSink, LogLevel::kDebug);
+}
+
+static void BinjaLogSink(LogLevel level, const char* message) {
+  switch (level) {
+    case LogLevel::kDebug:
+      LogDebug("%s", message);
+      break;
+    case LogLevel::kInfo:
+      LogInfo("%s", message);
+      break;
+    case LogLevel::kWarning:
+      LogWarn("%s", message);
+      break;
+    case LogLevel::kError:
+      LogError("%s", message);
+      break;
+  }
+}
+
+}  // namespace triton_bn
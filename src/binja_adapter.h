@@ -0,0 +1,45 @@
+#pragma once
+
+#include <binaryninjaapi.h>
+#include <triton/archEnums.hpp>
+
+#include "core/call_summary.h"
+#include "core/cfg.h"
+#include "core/code_source.h"
+
+namespace triton_bn {
+
+// Reads code from a "Binary Ninja" view
+class BinaryViewCodeSource : public CodeSource {
+ public:
+  explicit BinaryViewCodeSource(BinaryNinja::Ref<BinaryNinja::BinaryView> view)
+      : view_(std::move(view)) {}
+
+  size_t Read(uint64_t address, void* dest, size_t size) const override {
+    return view_->Read(dest, address, size);
+  }
+
+ private:
+  BinaryNinja::Ref<BinaryNinja::BinaryView> view_;
+};
+
+// Take a snapshot of the control flow graph of a given "Binary Ninja" function
+ControlFlowGraph SnapshotFunctionCfg(BinaryNinja::Function& function);
+// Same as above but for a single basic block, the resulting graph has a single
+// basic block and edges to other basic blocks don't have a target
+ControlFlowGraph SnapshotBasicBlockCfg(BinaryNinja::BasicBlock& basic_block);
+
+BNBranchType ToBinjaBranchType(BranchType type);
+
+// Summarize the effects of calls from the default calling convention of the
+// view's platform. Registers are matched with Triton's by name.
+// Returns false if there's no such calling convention, or if it can't be
+// summarized (e.g., callees pop their arguments).
+bool MakeDefaultCallSummary(BinaryNinja::BinaryView& view,
+                            triton::arch::architecture_e triton_arch,
+                            CallSummary& call_summary);
+
+// Forward the core's log messages to "Binary Ninja"'s log
+void InstallBinjaLogSink();
+
+}  // namespace triton_bn
@@ -3,70 +3,188 @@
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <iostream>
-#include <unordered_map>
+#include <iterator>
+#include <memory>
+#include <thread>
 #include <vector>
 
-#include "meta_basic_block.h"
+#include "binja_adapter.h"
+#include "core/arch_traits.h"
+#include "core/ast_memory_governor.h"
+#include "core/instrumentation.h"
+#include "core/liveness.h"
+#include "core/meta_basic_block.h"
+#include "core/progress.h"
+#include "core/simplification_pipeline.h"
+#include "flow_graph_builder.h"
+#include "patch_writer.h"
+#include "view_simplification_cache.h"
 
 namespace triton_bn {
 
 using namespace BinaryNinja;
 
-static std::vector<MetaBasicBlock> SimplifyBasicBlockCommon(
-    BinaryNinja::BinaryView* p_view, bool padding);
-static std::vector<MetaBasicBlock> SimplifyFunctionCommon(BinaryView* p_view,
-                                                          bool padding);
-static FlowGraph* GenerateFlowGraphFromMetaBasicBlocks(
-    std::vector<MetaBasicBlock> basic_blocks);
+// Key under which the latest instrumentation record is stored in the view's
+// metadata
+constexpr char kInstrumentationMetadataKey[] = "triton-bn.instrumentation";
+// Maximum number of basic blocks waiting between two pipeline stages in
+// memory-bounded mode
+constexpr size_t kMemoryBoundedQueueDepth = 8;
+
+// Relays the progress of an operation to a "Binary Ninja" background task, and
+// the task's cancellation to the operation
+class BackgroundTaskProgressMonitor : public ProgressMonitor {
+ public:
+  // Note: When `report_progress` is false, only the cancellation is relayed.
+  // This is useful when the task's progress text is managed at a higher level.
+  explicit BackgroundTaskProgressMonitor(Ref<BackgroundTask> task,
+                                         bool report_progress = true)
+      : task_(std::move(task)), report_progress_(report_progress) {}
+
+  bool IsCancelled() const override { return task_->IsCancelled(); }
+
+  void ReportProgress(const char* stage, size_t completed,
+                      size_t total) override {
+    if (!report_progress_) {
+      return;
+    }
 
-void SimplifyBasicBlockPreviewCommand(BinaryNinja::BinaryView* p_view) {
-  auto simplified_basic_blocks = SimplifyBasicBlockCommon(p_view, false);
-  if (simplified_basic_blocks.empty()) {
-    LogError("Failed to simplify basic block");
-    return;
+    // Updating the progress text is comparatively costly and progress can be
+    // reported for every basic block, so updates are rate-limited
+    const int64_t now =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    int64_t last_update = last_update_;
+    if (completed != total &&
+        now - last_update < kMinProgressUpdateIntervalMs) {
+      return;
+    }
+    if (!last_update_.compare_exchange_strong(last_update, now)) {
+      // Another thread is already updating the progress
+      return;
+    }
+    task_->SetProgressText(fmt::format("triton-bn: {} (block {}/{})", stage,
+                                       completed, total));
   }
 
-  // Construct result flow graph and display it
-  FlowGraph* flow_graph =
-      GenerateFlowGraphFromMetaBasicBlocks(std::move(simplified_basic_blocks));
+  void SetProgressText(const std::string& text) {
+    task_->SetProgressText(text);
+  }
 
-  const std::string report_title = fmt::format(
-      "Simplified basic block (0x{:x})", simplified_basic_blocks[0].GetStart());
-  p_view->ShowGraphReport(report_title, flow_graph);
+  const Ref<BackgroundTask>& task() const { return task_; }
+
+ private:
+  static constexpr int64_t kMinProgressUpdateIntervalMs = 100;
+
+  Ref<BackgroundTask> task_;
+  bool report_progress_;
+  std::atomic<int64_t> last_update_{0};
+};
+
+using BackgroundAction = std::function<void(BackgroundTaskProgressMonitor&)>;
+// Receives a function's basic blocks once they've been extracted and merged,
+// before their liveness is computed and they are simplified
+using ExtractionCallback =
+    std::function<void(const triton::Context& triton,
+                       const std::vector<MetaBasicBlock>& basic_blocks,
+                       const SimplificationOptions& options)>;
+
+static void RunInBackground(Ref<BinaryView> view,
+                            const std::string& initial_text,
+                            BackgroundAction action);
+static void ReportInstrumentation(BinaryView& view,
+                                  const Instrumentation& instrumentation);
+static void LogFailure(const ProgressMonitor& monitor, const char* message);
+static std::vector<MetaBasicBlock> SimplifyBasicBlockCommon(
+    BinaryView& view, uint64_t current_offset, bool padding,
+    ProgressMonitor& monitor, ControlFlowGraph& cfg);
+static bool SimplifyFunctionCommon(
+    BinaryView& view, uint64_t current_offset, bool padding,
+    ProgressMonitor& monitor, ControlFlowGraph& cfg,
+    const MetaBasicBlockSink& sink,
+    const ExtractionCallback& on_extracted = nullptr);
+static std::string GetFunctionName(BinaryView& view, uint64_t function_start);
+static Ref<FlowGraph> GenerateFlowGraphFromMetaBasicBlocks(
+    const triton::Context& triton, const ControlFlowGraph& cfg,
+    std::vector<MetaBasicBlock> basic_blocks);
+static SimplificationOptions GetSimplificationOptions(BinaryView& view,
+                                                      bool padding);
+static ViewSimplificationCache* GetPersistentCache(
+    BinaryView& view, const SimplificationOptions& options);
+static triton::arch::architecture_e GetTritonArchitecture(BinaryView& view);
 
-  LogInfo("Basic block has been simplified and preview rendered");
+void SimplifyBasicBlockPreviewCommand(BinaryNinja::BinaryView* p_view) {
+  Ref<BinaryView> view = p_view;
+  // Note: The selected address is read right away, the user may navigate
+  // elsewhere while the command runs
+  const uint64_t current_offset = p_view->GetCurrentOffset();
+  RunInBackground(
+      view, "triton-bn: Simplifying basic block",
+      [view, current_offset](BackgroundTaskProgressMonitor& monitor) {
+        ControlFlowGraph cfg{};
+        auto simplified_basic_blocks = SimplifyBasicBlockCommon(
+            *view, current_offset, false, monitor, cfg);
+        if (simplified_basic_blocks.empty()) {
+          LogFailure(monitor, "Failed to simplify basic block");
+          return;
+        }
+
+        // Construct result flow graph and display it
+        const triton::Context disassembler(GetTritonArchitecture(*view));
+        CountEvent(Counter::kTritonContexts);
+        const std::string report_title =
+            fmt::format("Simplified basic block (0x{:x})",
+                        simplified_basic_blocks[0].GetStart());
+        const Ref<FlowGraph> flow_graph = GenerateFlowGraphFromMetaBasicBlocks(
+            disassembler, cfg, std::move(simplified_basic_blocks));
+        view->ShowGraphReport(report_title, flow_graph);
+
+        LogInfo("Basic block has been simplified and preview rendered");
+      });
 }
 
 void SimplifyBasicBlockPatchCommand(BinaryNinja::BinaryView* p_view) {
-  auto simplified_basic_blocks = SimplifyBasicBlockCommon(p_view, true);
-  if (simplified_basic_blocks.empty()) {
-    LogError("Failed to simplify basic block");
-    return;
-  }
-
-  // Patch code
-  for (auto& basic_block : simplified_basic_blocks) {
-    for (auto& instruction : basic_block.triton_bb().getInstructions()) {
-      p_view->Write(instruction.getAddress(), instruction.getOpcode(),
-                    instruction.getSize());
-    }
-  }
-  // Rerun analysis
-  p_view->UpdateAnalysis();
-
-  LogInfo("Basic block has been simplified and patches applied");
+  Ref<BinaryView> view = p_view;
+  const uint64_t current_offset = p_view->GetCurrentOffset();
+  RunInBackground(
+      view, "triton-bn: Simplifying basic block",
+      [view, current_offset](BackgroundTaskProgressMonitor& monitor) {
+        ControlFlowGraph cfg{};
+        auto simplified_basic_blocks = SimplifyBasicBlockCommon(
+            *view, current_offset, true, monitor, cfg);
+        if (simplified_basic_blocks.empty()) {
+          LogFailure(monitor, "Failed to simplify basic block");
+          return;
+        }
+
+        // Patch code
+        monitor.SetProgressText("triton-bn: Applying patches");
+        const auto patch_statistics =
+            WritePatches(*view, simplified_basic_blocks);
+        LogDebug("%zu byte(s) patched in %zu write(s)",
+                 patch_statistics.changed_byte_count,
+                 patch_statistics.write_count);
+        // Rerun analysis
+        view->UpdateAnalysis();
+
+        LogInfo("Basic block has been simplified and patches applied");
+      });
 }
 
+// Note: `cfg` receives the snapshot the returned basic blocks refer to
 static std::vector<MetaBasicBlock> SimplifyBasicBlockCommon(
-    BinaryNinja::BinaryView* p_view, bool padding) {
-  // Get currently selected address in the view
-  const auto current_offset = p_view->GetCurrentOffset();
+    BinaryView& view, uint64_t current_offset, bool padding,
+    ProgressMonitor& monitor, ControlFlowGraph& cfg) {
   LogDebug("Current offset=0x%p", (void*)current_offset);
 
   // Find the function in which this address resides
   const auto candidate_basic_blocks =
-      p_view->GetBasicBlocksForAddress(current_offset);
+      view.GetBasicBlocksForAddress(current_offset);
   if (candidate_basic_blocks.empty()) {
     LogError("Failed to find the currently selected basic block");
     return {};
@@ -76,27 +194,28 @@ static std::vector<MetaBasicBlock> SimplifyBasicBlockCommon(
   LogDebug("Current basic block=0x%p", (void*)basic_block->GetStart());
 
   // Determine the current platform/architecture
-  const std::string architecture_name =
-      p_view->GetDefaultArchitecture()->GetName();
-  LogDebug("Architecture is '%s'", architecture_name.c_str());
-
-  triton::Context triton{};
-  if (architecture_name == "x86_64") {
-    triton.setArchitecture(triton::arch::ARCH_X86_64);
-  } else if (architecture_name == "x86") {
-    triton.setArchitecture(triton::arch::ARCH_X86);
-  } else if (architecture_name == "aarch64") {
-    triton.setArchitecture(triton::arch::ARCH_AARCH64);
-  } else {
-    LogError("Unsupported architecture '%s'", architecture_name.c_str());
+  const auto triton_arch = GetTritonArchitecture(view);
+  if (triton_arch == triton::arch::ARCH_INVALID) {
     return {};
   }
+  triton::Context triton{};
+  triton.setArchitecture(triton_arch);
+  CountEvent(Counter::kTritonContexts);
 
-  auto meta_basic_blocks =
-      ExtractMetaBasicBlocksFromBasicBlock(*p_view, basic_block, triton);
+  SimplificationOptions options = GetSimplificationOptions(view, padding);
+  options.monitor = &monitor;
+
+  cfg = SnapshotBasicBlockCfg(*basic_block);
+  if (auto* cache = GetPersistentCache(view, options)) {
+    cache->LoadPersistedResults(view, cfg.function_start);
+  }
+  auto meta_basic_blocks = ExtractMetaBasicBlocksFromBasicBlock(
+      BinaryViewCodeSource(&view), cfg, 0, triton,
+      !options.call_summary.has_value());
 
   // Simplify basic block
-  return SimplifyMetaBasicBlocks(triton, std::move(meta_basic_blocks), padding);
+  return SimplifyMetaBasicBlocks(triton, std::move(meta_basic_blocks),
+                                 options);
 }
 
 bool ValidateSimplifyBasicBlockCommand(BinaryView* p_view) {
@@ -104,99 +223,286 @@ bool ValidateSimplifyBasicBlockCommand(BinaryView* p_view) {
 }
 
 void SimplifyFunctionPreviewCommand(BinaryView* p_view) {
-  auto simplified_basic_blocks = SimplifyFunctionCommon(p_view, false);
-  if (simplified_basic_blocks.empty()) {
-    LogError("Failed to simplify function");
-    return;
-  }
-
-  // Construct result flow graph and display it
-  const auto candidate_functions =
-      p_view->GetAnalysisFunctionsContainingAddress(
-          simplified_basic_blocks[0].GetStart());
-  if (candidate_functions.empty()) {
-    LogError("Failed to simplify function");
-    return;
-  }
-
-  const std::string current_function_name =
-      candidate_functions[0]->GetSymbol()->GetFullName();
-  const std::string report_title =
-      fmt::format("Simplified function ({})", current_function_name);
-  FlowGraph* flow_graph =
-      GenerateFlowGraphFromMetaBasicBlocks(std::move(simplified_basic_blocks));
-  p_view->ShowGraphReport(report_title, flow_graph);
-
-  LogInfo("Function has been simplified and preview rendered");
+  Ref<BinaryView> view = p_view;
+  const uint64_t current_offset = p_view->GetCurrentOffset();
+  RunInBackground(
+      view, "triton-bn: Simplifying function",
+      [view, current_offset](BackgroundTaskProgressMonitor& monitor) {
+        // Note: Nodes are built as soon as basic blocks are simplified, which
+        // is when their instructions are disassembled
+        const auto triton_arch = GetTritonArchitecture(*view);
+        if (triton_arch == triton::arch::ARCH_INVALID) {
+          LogFailure(monitor, "Failed to simplify function");
+          return;
+        }
+        const triton::Context disassembler(triton_arch);
+        CountEvent(Counter::kTritonContexts);
+        ControlFlowGraph cfg{};
+        FlowGraphBuilder flow_graph_builder(cfg);
+        // Note: When enabled, a quickly simplified version of the function is
+        // displayed first, it is then refreshed as the full simplification
+        // completes
+        const bool progressive_preview =
+            Settings::Instance()->Get<bool>("triton-bn.progressivePreview");
+        Ref<ProgressiveFlowGraph> progressive_flow_graph{};
+        ExtractionCallback show_quick_preview =
+            [&](const triton::Context& triton,
+                const std::vector<MetaBasicBlock>& basic_blocks,
+                const SimplificationOptions& options) {
+              // Note: The quick pass doesn't execute anything, it isn't worth
+              // setting up a Triton context per thread
+              SimplificationOptions quick_options = options;
+              quick_options.quick = true;
+              quick_options.worker_count = 1;
+              auto quick_basic_blocks =
+                  SimplifyMetaBasicBlocks(triton, basic_blocks, quick_options);
+              if (quick_basic_blocks.empty()) {
+                return;
+              }
+
+              progressive_flow_graph = ProgressiveFlowGraph::Create(
+                  cfg, disassembler, quick_basic_blocks);
+              view->ShowGraphReport(
+                  fmt::format("Simplified function ({})",
+                              GetFunctionName(*view, cfg.function_start)),
+                  progressive_flow_graph.GetPtr());
+              LogDebug("Quick preview rendered, upgrading %zu basic block(s)",
+                       quick_basic_blocks.size());
+            };
+        const bool simplified = SimplifyFunctionCommon(
+            *view, current_offset, false, monitor, cfg,
+            [&](MetaBasicBlock meta_bb) {
+              if (progressive_flow_graph) {
+                progressive_flow_graph->UpgradeBasicBlock(disassembler,
+                                                          meta_bb);
+              } else {
+                flow_graph_builder.AddBasicBlock(disassembler, meta_bb);
+              }
+            },
+            progressive_preview ? show_quick_preview : nullptr);
+        if (progressive_flow_graph) {
+          if (!simplified) {
+            LogFailure(monitor, "Failed to fully simplify function, the "
+                                "preview only shows the quick simplification");
+            return;
+          }
+          LogInfo("Function has been simplified and preview upgraded");
+          return;
+        }
+        if (!simplified || flow_graph_builder.node_count() == 0) {
+          LogFailure(monitor, "Failed to simplify function");
+          return;
+        }
+
+        // Construct result flow graph and display it
+        const std::string report_title =
+            fmt::format("Simplified function ({})",
+                        GetFunctionName(*view, cfg.function_start));
+        const Ref<FlowGraph> flow_graph = flow_graph_builder.Finish();
+        view->ShowGraphReport(report_title, flow_graph);
+
+        LogInfo("Function has been simplified and preview rendered");
+      });
 }
 
 void SimplifyFunctionPatchCommand(BinaryView* p_view) {
-  auto simplified_basic_blocks = SimplifyFunctionCommon(p_view, true);
-  if (simplified_basic_blocks.empty()) {
-    LogError("Failed to simplify function");
-    return;
-  }
-
-  // Patch code
-  for (auto& basic_block : simplified_basic_blocks) {
-    for (auto& instruction : basic_block.triton_bb().getInstructions()) {
-      p_view->Write(instruction.getAddress(), instruction.getOpcode(),
-                    instruction.getSize());
-    }
-  }
-  // Rerun analysis
-  p_view->UpdateAnalysis();
-
-  LogInfo("Function has been simplified and patches applied");
+  Ref<BinaryView> view = p_view;
+  const uint64_t current_offset = p_view->GetCurrentOffset();
+  RunInBackground(
+      view, "triton-bn: Simplifying function",
+      [view, current_offset](BackgroundTaskProgressMonitor& monitor) {
+        ControlFlowGraph cfg{};
+        std::vector<MetaBasicBlock> simplified_basic_blocks{};
+        const bool simplified = SimplifyFunctionCommon(
+            *view, current_offset, true, monitor, cfg,
+            [&simplified_basic_blocks](MetaBasicBlock meta_bb) {
+              simplified_basic_blocks.emplace_back(std::move(meta_bb));
+            });
+        if (!simplified || simplified_basic_blocks.empty()) {
+          LogFailure(monitor, "Failed to simplify function");
+          return;
+        }
+
+        // Patch code
+        monitor.SetProgressText("triton-bn: Applying patches");
+        const auto patch_statistics =
+            WritePatches(*view, simplified_basic_blocks);
+        LogDebug("%zu byte(s) patched in %zu write(s)",
+                 patch_statistics.changed_byte_count,
+                 patch_statistics.write_count);
+        // Rerun analysis
+        view->UpdateAnalysis();
+
+        LogInfo("Function has been simplified and patches applied");
+      });
 }
 
-static std::vector<MetaBasicBlock> SimplifyFunctionCommon(BinaryView* p_view,
-                                                          bool padding) {
-  // Get currently selected address in the view
-  const auto current_offset = p_view->GetCurrentOffset();
+// Simplify the function containing `current_offset`, basic blocks are handed
+// to `sink` as soon as they're simplified. If `on_extracted` is set, the
+// function is extracted upfront and handed to it before being simplified.
+// Note: `cfg` receives the snapshot the basic blocks refer to, before `sink`
+// and `on_extracted` are called
+static bool SimplifyFunctionCommon(BinaryView& view, uint64_t current_offset,
+                                   bool padding, ProgressMonitor& monitor,
+                                   ControlFlowGraph& cfg,
+                                   const MetaBasicBlockSink& sink,
+                                   const ExtractionCallback& on_extracted) {
   LogDebug("Current offset=0x%p", (void*)current_offset);
 
   // Find the function in which this address resides
   const auto candidate_functions =
-      p_view->GetAnalysisFunctionsContainingAddress(current_offset);
+      view.GetAnalysisFunctionsContainingAddress(current_offset);
   if (candidate_functions.empty()) {
     LogError("Failed to find the currently selected function");
-    return {};
+    return false;
   }
   // TODO: Alert the users if multiple candidate functions exist
   const auto current_function = candidate_functions[0];
   LogDebug("Current function=0x%p", (void*)current_function->GetStart());
 
   // Determine the current architecture
-  const std::string architecture_name =
-      p_view->GetDefaultArchitecture()->GetName();
-  LogDebug("Architecture is '%s'", architecture_name.c_str());
-
+  const auto triton_arch = GetTritonArchitecture(view);
+  if (triton_arch == triton::arch::ARCH_INVALID) {
+    return false;
+  }
   // Intialize Triton's context
   triton::Context triton{};
-  if (architecture_name == "x86_64") {
-    triton.setArchitecture(triton::arch::ARCH_X86_64);
-  } else if (architecture_name == "x86") {
-    triton.setArchitecture(triton::arch::ARCH_X86);
-  } else if (architecture_name == "aarch64") {
-    triton.setArchitecture(triton::arch::ARCH_AARCH64);
+  triton.setArchitecture(triton_arch);
+  CountEvent(Counter::kTritonContexts);
+
+  SimplificationOptions options = GetSimplificationOptions(view, padding);
+  options.monitor = &monitor;
+  const CallSummary* call_summary =
+      options.call_summary.has_value() ? &*options.call_summary : nullptr;
+
+  // Create `MetaBasicBlock`s from the current Binja function's basic blocks
+  cfg = SnapshotFunctionCfg(*current_function);
+  if (auto* cache = GetPersistentCache(view, options)) {
+    cache->LoadPersistedResults(view, cfg.function_start);
+  }
+  const BinaryViewCodeSource code(&view);
+  const bool merge_basic_blocks =
+      Settings::Instance()->Get<bool>("triton-bn.mergeBasicBlocks");
+  const bool cross_block_liveness =
+      Settings::Instance()->Get<bool>("triton-bn.crossBlockLiveness");
+  std::unique_ptr<MetaBasicBlockSource> source{};
+  if (on_extracted) {
+    // Note: The callback needs the whole function, so it's extracted upfront
+    auto meta_basic_blocks = ExtractMetaBasicBlocksFromFunction(
+        code, cfg, triton, &monitor, call_summary == nullptr);
+    LogDebug("%zu meta basic block(s) extracted", meta_basic_blocks.size());
+
+    if (merge_basic_blocks) {
+      // Merge basic blocks
+      meta_basic_blocks =
+          MergeMetaBasicBlocks(cfg, std::move(meta_basic_blocks), &monitor);
+    }
+    // Note: Called before liveness is computed, which executes the whole
+    // function
+    if (on_extracted) {
+      on_extracted(triton, meta_basic_blocks, options);
+    }
+    if (cross_block_liveness) {
+      ComputeLiveOutRegisters(triton, cfg, meta_basic_blocks, call_summary,
+                              &monitor);
+    }
+    source = std::make_unique<MetaBasicBlockListSource>(
+        std::move(meta_basic_blocks));
+  } else if (merge_basic_blocks || cross_block_liveness) {
+    // Basic blocks are extracted, merged and analyzed while others are being
+    // simplified
+    source = std::make_unique<FunctionExtractionSource>(
+        code, cfg, triton, merge_basic_blocks, cross_block_liveness,
+        call_summary);
   } else {
-    LogError("Unsupported architecture '%s'", architecture_name.c_str());
-    return {};
+    // Basic blocks are extracted while others are being simplified
+    source = std::make_unique<CfgExtractionSource>(code, cfg, triton,
+                                                   call_summary == nullptr);
   }
 
-  // Create `MetaBasicBlock`s from the current Binja function's basic blocks
-  auto meta_basic_blocks =
-      ExtractMetaBasicBlocksFromFunction(*p_view, current_function, triton);
-  LogDebug("%zu meta basic block(s) extracted", meta_basic_blocks.size());
+  // Simplify basic blocks
+  return RunSimplificationPipeline(triton, *source, sink, options);
+}
 
-  if (Settings::Instance()->Get<bool>("triton-bn.mergeBasicBlocks")) {
-    // Merge basic blocks
-    meta_basic_blocks = MergeMetaBasicBlocks(std::move(meta_basic_blocks));
+void SimplifyAllFunctionsPatchCommand(BinaryView* p_view) {
+  const auto triton_arch = GetTritonArchitecture(*p_view);
+  if (triton_arch == triton::arch::ARCH_INVALID) {
+    return;
   }
 
-  // Simplify basic blocks
-  return SimplifyMetaBasicBlocks(triton, std::move(meta_basic_blocks), padding);
+  Ref<BinaryView> view = p_view;
+  RunInBackground(
+      view, "triton-bn: Simplifying all functions",
+      [view, triton_arch](BackgroundTaskProgressMonitor& monitor) {
+        std::vector<ControlFlowGraph> cfgs{};
+        for (const auto& function : view->GetAnalysisFunctionList()) {
+          cfgs.emplace_back(SnapshotFunctionCfg(*function));
+        }
+
+        FunctionBatchOptions options{};
+        options.merge_basic_blocks =
+            Settings::Instance()->Get<bool>("triton-bn.mergeBasicBlocks");
+        options.cross_block_liveness =
+            Settings::Instance()->Get<bool>("triton-bn.crossBlockLiveness");
+        options.simplification = GetSimplificationOptions(*view, true);
+        options.worker_count = options.simplification.worker_count;
+        // Note: Progress is reported per function rather than per basic
+        // block, the monitor given to the simplification only relays
+        // cancellation
+        BackgroundTaskProgressMonitor function_monitor(monitor.task(), false);
+        options.simplification.monitor = &function_monitor;
+        ViewSimplificationCache* persistent_cache =
+            GetPersistentCache(*view, options.simplification);
+
+        FunctionBatchCallbacks callbacks{};
+        if (persistent_cache != nullptr) {
+          callbacks.before_extraction = [&](size_t,
+                                            const ControlFlowGraph& cfg) {
+            persistent_cache->LoadPersistedResults(*view, cfg.function_start);
+          };
+        }
+        std::atomic<size_t> processed_function_count{0};
+        callbacks.on_simplified = [&](size_t,
+                                      const std::vector<MetaBasicBlock>&) {
+          const size_t processed_count = ++processed_function_count;
+          monitor.SetProgressText(
+              fmt::format("triton-bn: Simplifying all functions ({}/{})",
+                          processed_count, cfgs.size()));
+        };
+        auto simplified_functions =
+            SimplifyFunctions(BinaryViewCodeSource(view), triton_arch, cfgs,
+                              options, callbacks);
+
+        if (monitor.IsCancelled()) {
+          LogInfo("Simplification of all functions cancelled, nothing patched");
+          return;
+        }
+
+        // Patch code
+        monitor.SetProgressText("triton-bn: Applying patches");
+        // Note: Everything is written at once so that all patches can be undone
+        // in a single step
+        std::vector<MetaBasicBlock> simplified_basic_blocks{};
+        size_t simplified_function_count = 0;
+        for (auto& function_basic_blocks : simplified_functions) {
+          if (!function_basic_blocks.empty()) {
+            simplified_function_count++;
+          }
+          std::move(std::begin(function_basic_blocks),
+                    std::end(function_basic_blocks),
+                    std::back_inserter(simplified_basic_blocks));
+        }
+        const auto patch_statistics =
+            WritePatches(*view, simplified_basic_blocks);
+        LogDebug("%zu byte(s) patched in %zu write(s)",
+                 patch_statistics.changed_byte_count,
+                 patch_statistics.write_count);
+        // Rerun analysis
+        view->UpdateAnalysis();
+
+        LogInfo("%zu function(s) have been simplified and patches applied",
+                simplified_function_count);
+      });
 }
 
 bool ValidateSimplifyFunctionCommand(BinaryView* p_view) {
@@ -208,8 +514,7 @@ bool ValidateSimplifyFunctionCommand(BinaryView* p_view) {
   // Check platform compatibility
   const std::string architecture_name =
       view.GetDefaultArchitecture()->GetName();
-  if (architecture_name != "x86_64" && architecture_name != "x86" &&
-      architecture_name != "aarch64") {
+  if (ArchitectureFromName(architecture_name) == triton::arch::ARCH_INVALID) {
     LogError("Unsupported architecture");
     return false;
   }
@@ -217,69 +522,143 @@ bool ValidateSimplifyFunctionCommand(BinaryView* p_view) {
   return true;
 }
 
-static FlowGraph* GenerateFlowGraphFromMetaBasicBlocks(
-    std::vector<MetaBasicBlock> basic_blocks) {
-  auto* flow_graph = new FlowGraph();
+// Name of the function starting at `function_start`, for display purposes
+static std::string GetFunctionName(BinaryView& view, uint64_t function_start) {
+  const auto candidate_functions =
+      view.GetAnalysisFunctionsContainingAddress(function_start);
+  if (candidate_functions.empty()) {
+    return fmt::format("sub_{:x}", function_start);
+  }
 
-  std::unordered_map<uint64_t, FlowGraphNode*> graph_nodes_addr_map{};
-  std::vector<FlowGraphNode*> graph_nodes{};
-  for (auto& meta_bb : basic_blocks) {
-    // Generate disassembly
-    std::vector<DisassemblyTextLine> disassembly_lines{};
-    const auto& instructions = meta_bb.triton_bb().getInstructions();
-    for (auto& instr : instructions) {
-      InstructionTextToken instr_token(
-          BNInstructionTextTokenType::InstructionToken, instr.getDisassembly(),
-          0, static_cast<size_t>(instr.getSize()));
-      instr_token.address = instr.getAddress();
-
-      {
-        DisassemblyTextLine line;
-        line.addr = instr.getAddress();
-        line.tokens = {instr_token};
-        disassembly_lines.emplace_back(std::move(line));
-      }
-    }
+  return candidate_functions[0]->GetSymbol()->GetFullName();
+}
 
-    // Construct new node
-    {
-      auto* node = new FlowGraphNode(flow_graph);
-      node->SetLines(disassembly_lines);
-      graph_nodes.emplace_back(node);
-      graph_nodes_addr_map[meta_bb.GetStart()] = node;
+static triton::arch::architecture_e GetTritonArchitecture(BinaryView& view) {
+  const std::string architecture_name =
+      view.GetDefaultArchitecture()->GetName();
+  LogDebug("Architecture is '%s'", architecture_name.c_str());
+
+  const auto triton_arch = ArchitectureFromName(architecture_name);
+  if (triton_arch == triton::arch::ARCH_INVALID) {
+    LogError("Unsupported architecture '%s'", architecture_name.c_str());
+  }
+  return triton_arch;
+}
+
+static SimplificationOptions GetSimplificationOptions(BinaryView& view,
+                                                      bool padding) {
+  auto settings = Settings::Instance();
+
+  SimplificationOptions options{};
+  options.padding = padding;
+  options.worker_count =
+      static_cast<size_t>(settings->Get<uint64_t>("triton-bn.workerCount"));
+  options.max_rounds = static_cast<size_t>(
+      settings->Get<uint64_t>("triton-bn.maxSimplificationRounds"));
+  options.budget.time_limit_ms =
+      settings->Get<uint64_t>("triton-bn.blockTimeBudget");
+  options.budget.ast_node_limit = static_cast<size_t>(
+      settings->Get<uint64_t>("triton-bn.blockAstNodeBudget"));
+  if (settings->Get<std::string>("triton-bn.budgetFallback") == "unchanged") {
+    options.budget.fallback = BudgetFallback::kUnchanged;
+  }
+  if (settings->Get<bool>("triton-bn.memoryBoundedMode")) {
+    AstMemoryGovernor& memory_governor = AstMemoryGovernor::Instance();
+    memory_governor.SetCeiling(
+        settings->Get<uint64_t>("triton-bn.symbolicMemoryCeiling") << 20);
+    options.memory_governor = &memory_governor;
+    options.queue_depth = kMemoryBoundedQueueDepth;
+  }
+  if (settings->Get<bool>("triton-bn.incrementalSimplification")) {
+    options.cache = &ViewSimplificationCache::ForView(view);
+  }
+  if (settings->Get<bool>("triton-bn.callSummaries")) {
+    // Note: Basic blocks are split at calls if they can't be summarized
+    CallSummary call_summary{};
+    if (MakeDefaultCallSummary(view, GetTritonArchitecture(view),
+                               call_summary)) {
+      options.call_summary = std::move(call_summary);
     }
   }
 
-  if (basic_blocks.size() != graph_nodes.size()) {
-    LogError("Invalid graph node count");
+  return options;
+}
+
+// Cache whose results are persisted in the view's metadata, null if results
+// aren't cached or persisted
+static ViewSimplificationCache* GetPersistentCache(
+    BinaryView& view, const SimplificationOptions& options) {
+  if (options.cache == nullptr ||
+      !Settings::Instance()->Get<bool>("triton-bn.persistResults")) {
     return nullptr;
   }
 
-  // Construct graph
-  for (size_t i = 0; i < graph_nodes.size(); i++) {
-    FlowGraphNode* graph_node = graph_nodes[i];
-    MetaBasicBlock& meta_bb = basic_blocks[i];
-
-    // Resolve outgoing edges
-    for (const BasicBlockEdge& outgoing_edge : meta_bb.outgoing_edges()) {
-      const BasicBlock* target = outgoing_edge.target;
-      if (target == nullptr) {
-        continue;
-      }
-
-      const uint64_t target_addr = target->GetStart();
-      const auto node_it = graph_nodes_addr_map.find(target_addr);
-      if (node_it == std::cend(graph_nodes_addr_map)) {
-        continue;
-      }
-
-      graph_node->AddOutgoingEdge(outgoing_edge.type, node_it->second);
+  return &ViewSimplificationCache::ForView(view);
+}
+
+// Run the given action in a separate thread, tracked by a cancellable
+// "Binary Ninja" background task
+static void RunInBackground(Ref<BinaryView> view,
+                            const std::string& initial_text,
+                            BackgroundAction action) {
+  const bool instrumentation_enabled =
+      Settings::Instance()->Get<bool>("triton-bn.instrumentation");
+  const bool persist_results =
+      Settings::Instance()->Get<bool>("triton-bn.persistResults");
+
+  Ref<BackgroundTask> task = new BackgroundTask(initial_text, true);
+  std::thread([view, task, instrumentation_enabled, persist_results,
+               action = std::move(action)]() {
+    // Note: Each command collects its own statistics, so that commands
+    // running concurrently don't mix or reset each other's
+    Instrumentation instrumentation{};
+    instrumentation.SetEnabled(instrumentation_enabled);
+    ScopedInstrumentation scoped_instrumentation(instrumentation);
+
+    BackgroundTaskProgressMonitor monitor(task);
+    action(monitor);
+
+    // Note: Results computed before a cancellation are kept as well
+    if (persist_results) {
+      monitor.SetProgressText("triton-bn: Saving simplification results");
+      ViewSimplificationCache::PersistView(*view);
     }
+    if (instrumentation_enabled) {
+      ReportInstrumentation(*view, instrumentation);
+    }
+    task->Finish();
+  }).detach();
+}
+
+// Log a summary of the collected statistics and store the full record in the
+// view's metadata, so that it can be retrieved by scripts
+static void ReportInstrumentation(BinaryView& view,
+                                  const Instrumentation& instrumentation) {
+  LogInfo("%s", instrumentation.GenerateSummary().c_str());
 
-    flow_graph->AddNode(graph_node);
+  Ref<Metadata> record = new Metadata(instrumentation.GenerateJson());
+  view.StoreMetadata(kInstrumentationMetadataKey, record, true);
+}
+
+// Log the failure of an operation, unless it's been cancelled by the user
+static void LogFailure(const ProgressMonitor& monitor, const char* message) {
+  if (monitor.IsCancelled()) {
+    LogInfo("Operation cancelled");
+    return;
+  }
+  LogError("%s", message);
+}
+
+// Note: Instructions are disassembled with `triton` as they're rendered
+static Ref<FlowGraph> GenerateFlowGraphFromMetaBasicBlocks(
+    const triton::Context& triton, const ControlFlowGraph& cfg,
+    std::vector<MetaBasicBlock> basic_blocks) {
+  FlowGraphBuilder flow_graph_builder(cfg);
+  for (auto& meta_bb : basic_blocks) {
+    flow_graph_builder.AddBasicBlock(triton, meta_bb);
   }
 
-  return flow_graph;
+  return flow_graph_builder.Finish();
 }
 
 }  // namespace triton_bn
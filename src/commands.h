@@ -12,4 +12,6 @@ void SimplifyFunctionPreviewCommand(BinaryNinja::BinaryView* p_view);
 void SimplifyFunctionPatchCommand(BinaryNinja::BinaryView* p_view);
 bool ValidateSimplifyFunctionCommand(BinaryNinja::BinaryView* p_view);
 
+void SimplifyAllFunctionsPatchCommand(BinaryNinja::BinaryView* p_view);
+
 }  // namespace triton_bn
@@ -0,0 +1,32 @@
+#include "arch_traits.h"
+
+namespace triton_bn {
+
+triton::arch::architecture_e ArchitectureFromName(std::string_view name) {
+  if (name == "x86_64") {
+    return triton::arch::ARCH_X86_64;
+  }
+  if (name == "x86") {
+    return triton::arch::ARCH_X86;
+  }
+  if (name == "aarch64") {
+    return triton::arch::ARCH_AARCH64;
+  }
+
+  return triton::arch::ARCH_INVALID;
+}
+
+const char* GetArchitectureName(triton::arch::architecture_e architecture) {
+  switch (architecture) {
+    case triton::arch::ARCH_X86_64:
+      return "x86_64";
+    case triton::arch::ARCH_X86:
+      return "x86";
+    case triton::arch::ARCH_AARCH64:
+      return "aarch64";
+    default:
+      return "unknown";
+  }
+}
+
+}  // namespace triton_bn
@@ -0,0 +1,372 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <triton/aarch64Specifications.hpp>
+#include <triton/archEnums.hpp>
+#include <triton/instruction.hpp>
+#include <triton/x86Specifications.hpp>
+
+namespace triton_bn {
+
+// Whether `type` is one of `types`
+template <size_t N>
+constexpr bool IsOneOf(triton::uint32 type, const triton::uint32 (&types)[N]) {
+  for (size_t i = 0; i < N; i++) {
+    if (types[i] == type) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Flags an instruction reads and overwrites, as masks of the flags of its
+// architecture (see `ArchTraits<>::kAllFlags`)
+struct FlagEffects {
+  triton::uint32 uses = 0;
+  triton::uint32 defs = 0;
+  // Whether writing flags is all the instruction does
+  bool flags_only = false;
+};
+
+// Whether `operand` is a whole general-purpose register, `gpr_bit_size` bits
+// wide.
+// Note: Writes to part of a register may zero-extend it (e.g., `eax` on
+// x86-64), moving part of a register to itself isn't a no-op
+inline bool IsWholeGpr(const triton::arch::OperandWrapper& operand,
+                       triton::uint32 gpr_bit_size) {
+  if (operand.getType() != triton::arch::OP_REG) {
+    return false;
+  }
+  const auto& reg = operand.getConstRegister();
+  return reg.getId() == reg.getParent() && reg.getBitSize() == gpr_bit_size;
+}
+
+// Whether `instr` moves a whole general-purpose register to itself
+inline bool IsMoveToItself(const triton::arch::Instruction& instr,
+                           triton::uint32 gpr_bit_size) {
+  return instr.operands.size() == 2 &&
+         IsWholeGpr(instr.operands[0], gpr_bit_size) &&
+         IsWholeGpr(instr.operands[1], gpr_bit_size) &&
+         instr.operands[0].getConstRegister().getId() ==
+             instr.operands[1].getConstRegister().getId();
+}
+
+// Classification of the instructions of an architecture supported by Triton,
+// from the instruction types set by Triton when disassembling them. Code that
+// runs for each instruction is specialized for each architecture with
+// `DispatchArchitecture`, instead of checking the architecture every time.
+template <triton::arch::architecture_e Architecture>
+struct ArchTraits;
+
+struct X86TraitsBase {
+  static constexpr bool kSupported = true;
+  static constexpr triton::uint32 kCallTypes[] = {
+      triton::arch::x86::ID_INS_CALL,
+      triton::arch::x86::ID_INS_LCALL,
+  };
+  static constexpr triton::uint32 kJumpTypes[] = {
+      triton::arch::x86::ID_INS_JMP,
+      triton::arch::x86::ID_INS_LJMP,
+  };
+  static constexpr triton::uint32 kReturnTypes[] = {
+      triton::arch::x86::ID_INS_RET,   triton::arch::x86::ID_INS_RETF,
+      triton::arch::x86::ID_INS_RETFQ, triton::arch::x86::ID_INS_IRET,
+      triton::arch::x86::ID_INS_IRETD, triton::arch::x86::ID_INS_IRETQ,
+  };
+  // `jcc`, `jcxz` and `loop` variants
+  static constexpr triton::uint32 kConditionalBranchTypes[] = {
+      triton::arch::x86::ID_INS_JA,     triton::arch::x86::ID_INS_JAE,
+      triton::arch::x86::ID_INS_JB,     triton::arch::x86::ID_INS_JBE,
+      triton::arch::x86::ID_INS_JCXZ,   triton::arch::x86::ID_INS_JE,
+      triton::arch::x86::ID_INS_JECXZ,  triton::arch::x86::ID_INS_JG,
+      triton::arch::x86::ID_INS_JGE,    triton::arch::x86::ID_INS_JL,
+      triton::arch::x86::ID_INS_JLE,    triton::arch::x86::ID_INS_JNE,
+      triton::arch::x86::ID_INS_JNO,    triton::arch::x86::ID_INS_JNP,
+      triton::arch::x86::ID_INS_JNS,    triton::arch::x86::ID_INS_JO,
+      triton::arch::x86::ID_INS_JP,     triton::arch::x86::ID_INS_JRCXZ,
+      triton::arch::x86::ID_INS_JS,     triton::arch::x86::ID_INS_LOOP,
+      triton::arch::x86::ID_INS_LOOPE,  triton::arch::x86::ID_INS_LOOPNE,
+  };
+  // CF, PF, AF, ZF, SF and OF
+  static constexpr triton::uint32 kAllFlags = 0x3f;
+  static constexpr triton::uint32 kCarryFlag = 0x1;
+  // Overwrite every flag and do nothing else
+  static constexpr triton::uint32 kFlagOnlyTypes[] = {
+      triton::arch::x86::ID_INS_CMP,
+      triton::arch::x86::ID_INS_TEST,
+  };
+  // Overwrite every flag without reading any, besides writing their result
+  static constexpr triton::uint32 kFlagWritingTypes[] = {
+      triton::arch::x86::ID_INS_ADD, triton::arch::x86::ID_INS_SUB,
+      triton::arch::x86::ID_INS_AND, triton::arch::x86::ID_INS_OR,
+      triton::arch::x86::ID_INS_XOR, triton::arch::x86::ID_INS_NEG,
+  };
+  // Neither read nor write flags
+  static constexpr triton::uint32 kFlagNeutralTypes[] = {
+      triton::arch::x86::ID_INS_MOV,    triton::arch::x86::ID_INS_MOVZX,
+      triton::arch::x86::ID_INS_MOVSX,  triton::arch::x86::ID_INS_MOVSXD,
+      triton::arch::x86::ID_INS_MOVABS, triton::arch::x86::ID_INS_LEA,
+      triton::arch::x86::ID_INS_PUSH,   triton::arch::x86::ID_INS_POP,
+      triton::arch::x86::ID_INS_XCHG,   triton::arch::x86::ID_INS_NOT,
+      triton::arch::x86::ID_INS_BSWAP,  triton::arch::x86::ID_INS_NOP,
+      triton::arch::x86::ID_INS_JMP,
+  };
+
+  static bool IsCall(const triton::arch::Instruction& instr) {
+    return IsOneOf(instr.getType(), kCallTypes);
+  }
+  // Unconditional direct or indirect jumps
+  static bool IsJump(const triton::arch::Instruction& instr) {
+    return IsOneOf(instr.getType(), kJumpTypes);
+  }
+  static bool IsReturn(const triton::arch::Instruction& instr) {
+    return IsOneOf(instr.getType(), kReturnTypes);
+  }
+  static bool IsConditionalBranch(const triton::arch::Instruction& instr) {
+    return IsOneOf(instr.getType(), kConditionalBranchTypes);
+  }
+  // `hlt` and `ud2`
+  // Note: Matched on their encoding, Triton doesn't flag them as control flow
+  // instructions
+  static bool IsTrap(const triton::arch::Instruction& instr) {
+    const triton::uint8* opcode = instr.getOpcode();
+    return (instr.getSize() == 1 && opcode[0] == 0xf4) ||
+           (instr.getSize() == 2 && opcode[0] == 0x0f && opcode[1] == 0x0b);
+  }
+  // Note: Instructions that aren't listed are considered to read every flag
+  static FlagEffects GetFlagEffects(const triton::arch::Instruction& instr) {
+    const triton::uint32 type = instr.getType();
+    if (IsOneOf(type, kFlagOnlyTypes)) {
+      return {0, kAllFlags, true};
+    }
+    if (IsOneOf(type, kFlagWritingTypes)) {
+      return {0, kAllFlags, false};
+    }
+    // Note: `inc` and `dec` leave CF untouched
+    if (type == triton::arch::x86::ID_INS_INC ||
+        type == triton::arch::x86::ID_INS_DEC) {
+      return {0, kAllFlags & ~kCarryFlag, false};
+    }
+    if (IsOneOf(type, kFlagNeutralTypes)) {
+      return {};
+    }
+    return {kAllFlags, 0, false};
+  }
+  // `nop`, moves and exchanges of a register with itself and `lea` of a
+  // register's own value
+  // Note: Found from the instruction's operands, nothing is executed
+  static bool IsSyntacticNop(const triton::arch::Instruction& instr,
+                             triton::uint32 gpr_bit_size) {
+    switch (instr.getType()) {
+      case triton::arch::x86::ID_INS_NOP:
+        return true;
+      case triton::arch::x86::ID_INS_MOV:
+      case triton::arch::x86::ID_INS_XCHG:
+        return IsMoveToItself(instr, gpr_bit_size);
+      case triton::arch::x86::ID_INS_LEA: {
+        if (instr.operands.size() != 2 ||
+            !IsWholeGpr(instr.operands[0], gpr_bit_size) ||
+            instr.operands[1].getType() != triton::arch::OP_MEM) {
+          return false;
+        }
+        const auto& mem = instr.operands[1].getConstMemory();
+        return mem.getConstBaseRegister().getId() ==
+                   instr.operands[0].getConstRegister().getId() &&
+               mem.getConstIndexRegister().getId() ==
+                   triton::arch::ID_REG_INVALID &&
+               mem.getConstDisplacement().getValue() == 0;
+      }
+      default:
+        return false;
+    }
+  }
+};
+
+template <>
+struct ArchTraits<triton::arch::ARCH_X86> : X86TraitsBase {
+  static constexpr triton::arch::architecture_e kArchitecture =
+      triton::arch::ARCH_X86;
+  static constexpr triton::arch::register_e kProgramCounter =
+      triton::arch::ID_REG_X86_EIP;
+};
+
+template <>
+struct ArchTraits<triton::arch::ARCH_X86_64> : X86TraitsBase {
+  static constexpr triton::arch::architecture_e kArchitecture =
+      triton::arch::ARCH_X86_64;
+  static constexpr triton::arch::register_e kProgramCounter =
+      triton::arch::ID_REG_X86_RIP;
+};
+
+template <>
+struct ArchTraits<triton::arch::ARCH_AARCH64> {
+  static constexpr triton::arch::architecture_e kArchitecture =
+      triton::arch::ARCH_AARCH64;
+  static constexpr bool kSupported = true;
+  static constexpr triton::arch::register_e kProgramCounter =
+      triton::arch::ID_REG_AARCH64_PC;
+  // Including their authenticated variants (`blraa`, ...)
+  static constexpr triton::uint32 kCallTypes[] = {
+      triton::arch::arm::aarch64::ID_INS_BL,
+      triton::arch::arm::aarch64::ID_INS_BLR,
+      triton::arch::arm::aarch64::ID_INS_BLRAA,
+      triton::arch::arm::aarch64::ID_INS_BLRAAZ,
+      triton::arch::arm::aarch64::ID_INS_BLRAB,
+      triton::arch::arm::aarch64::ID_INS_BLRABZ,
+  };
+  static constexpr triton::uint32 kJumpTypes[] = {
+      triton::arch::arm::aarch64::ID_INS_B,
+      triton::arch::arm::aarch64::ID_INS_BR,
+      triton::arch::arm::aarch64::ID_INS_BRAA,
+      triton::arch::arm::aarch64::ID_INS_BRAAZ,
+      triton::arch::arm::aarch64::ID_INS_BRAB,
+      triton::arch::arm::aarch64::ID_INS_BRABZ,
+  };
+  static constexpr triton::uint32 kReturnTypes[] = {
+      triton::arch::arm::aarch64::ID_INS_RET,
+      triton::arch::arm::aarch64::ID_INS_RETAA,
+      triton::arch::arm::aarch64::ID_INS_RETAB,
+      triton::arch::arm::aarch64::ID_INS_ERET,
+      triton::arch::arm::aarch64::ID_INS_ERETAA,
+      triton::arch::arm::aarch64::ID_INS_ERETAB,
+  };
+  // Note: `b.XX` isn't listed, see `IsConditionalBranch`
+  static constexpr triton::uint32 kConditionalBranchTypes[] = {
+      triton::arch::arm::aarch64::ID_INS_CBZ,
+      triton::arch::arm::aarch64::ID_INS_CBNZ,
+      triton::arch::arm::aarch64::ID_INS_TBZ,
+      triton::arch::arm::aarch64::ID_INS_TBNZ,
+  };
+  // N, Z, C and V
+  static constexpr triton::uint32 kAllFlags = 0xf;
+  // `cmp`, `cmn` and `tst`, which only set flags
+  static constexpr triton::uint32 kFlagOnlyTypes[] = {
+      triton::arch::arm::aarch64::ID_INS_CMP,
+      triton::arch::arm::aarch64::ID_INS_CMN,
+      triton::arch::arm::aarch64::ID_INS_TST,
+  };
+  // Read the carry flag (or all of them, for `mrs`) without being conditioned
+  static constexpr triton::uint32 kFlagReadingTypes[] = {
+      triton::arch::arm::aarch64::ID_INS_ADC,
+      triton::arch::arm::aarch64::ID_INS_SBC,
+      triton::arch::arm::aarch64::ID_INS_NGC,
+      triton::arch::arm::aarch64::ID_INS_NGCS,
+      triton::arch::arm::aarch64::ID_INS_MRS,
+  };
+
+  static bool IsCall(const triton::arch::Instruction& instr) {
+    return IsOneOf(instr.getType(), kCallTypes);
+  }
+  // Note: `b.XX` has the same type as `b`, only its condition differs
+  static bool IsJump(const triton::arch::Instruction& instr) {
+    return IsOneOf(instr.getType(), kJumpTypes) && !IsConditioned(instr);
+  }
+  static bool IsReturn(const triton::arch::Instruction& instr) {
+    return IsOneOf(instr.getType(), kReturnTypes);
+  }
+  static bool IsConditionalBranch(const triton::arch::Instruction& instr) {
+    return IsOneOf(instr.getType(), kConditionalBranchTypes) ||
+           (instr.getType() == triton::arch::arm::aarch64::ID_INS_B &&
+            IsConditioned(instr));
+  }
+  // `udf` and `brk`
+  static bool IsTrap(const triton::arch::Instruction& instr) {
+    const triton::uint8* opcode = instr.getOpcode();
+    const uint32_t encoding = static_cast<uint32_t>(opcode[0]) |
+                              static_cast<uint32_t>(opcode[1]) << 8 |
+                              static_cast<uint32_t>(opcode[2]) << 16 |
+                              static_cast<uint32_t>(opcode[3]) << 24;
+    return (encoding & 0xffff0000) == 0 ||
+           (encoding & 0xffe0001f) == 0xd4200000;
+  }
+  // Note: Besides the listed instructions, only conditioned instructions read
+  // flags, and only those flagged by Triton as updating flags (`adds`, ...)
+  // write them. Calls are considered to read every flag.
+  static FlagEffects GetFlagEffects(const triton::arch::Instruction& instr) {
+    FlagEffects effects{};
+    const triton::uint32 type = instr.getType();
+    if (IsConditioned(instr) || IsOneOf(type, kFlagReadingTypes) ||
+        IsCall(instr)) {
+      effects.uses = kAllFlags;
+    }
+    effects.flags_only = IsOneOf(type, kFlagOnlyTypes);
+    if (effects.flags_only || instr.isUpdateFlag()) {
+      effects.defs = kAllFlags;
+    }
+    return effects;
+  }
+  // `nop` and moves of a register to itself
+  // Note: Found from the instruction's operands, nothing is executed
+  static bool IsSyntacticNop(const triton::arch::Instruction& instr,
+                             triton::uint32 gpr_bit_size) {
+    switch (instr.getType()) {
+      case triton::arch::arm::aarch64::ID_INS_NOP:
+        return true;
+      case triton::arch::arm::aarch64::ID_INS_MOV:
+        return IsMoveToItself(instr, gpr_bit_size);
+      default:
+        return false;
+    }
+  }
+
+ private:
+  static bool IsConditioned(const triton::arch::Instruction& instr) {
+    const auto condition = instr.getCodeCondition();
+    return condition != triton::arch::arm::ID_CONDITION_INVALID &&
+           condition != triton::arch::arm::ID_CONDITION_AL;
+  }
+};
+
+// Architectures Triton doesn't support, nothing is classified
+template <>
+struct ArchTraits<triton::arch::ARCH_INVALID> {
+  static constexpr triton::arch::architecture_e kArchitecture =
+      triton::arch::ARCH_INVALID;
+  static constexpr bool kSupported = false;
+  static constexpr triton::uint32 kAllFlags = 0;
+  static constexpr triton::arch::register_e kProgramCounter =
+      triton::arch::ID_REG_INVALID;
+
+  static bool IsCall(const triton::arch::Instruction&) { return false; }
+  static bool IsJump(const triton::arch::Instruction&) { return false; }
+  static bool IsReturn(const triton::arch::Instruction&) { return false; }
+  static bool IsConditionalBranch(const triton::arch::Instruction&) {
+    return false;
+  }
+  static bool IsTrap(const triton::arch::Instruction&) { return false; }
+  static FlagEffects GetFlagEffects(const triton::arch::Instruction&) {
+    return {};
+  }
+  static bool IsSyntacticNop(const triton::arch::Instruction&,
+                             triton::uint32) {
+    return false;
+  }
+};
+
+// Call `fn` with the `ArchTraits` of `architecture`, default-constructed, and
+// return its result. `fn` is instantiated for each architecture, so it must
+// return the same type for all of them.
+template <typename Fn>
+decltype(auto) DispatchArchitecture(triton::arch::architecture_e architecture,
+                                    Fn&& fn) {
+  switch (architecture) {
+    case triton::arch::ARCH_X86:
+      return fn(ArchTraits<triton::arch::ARCH_X86>{});
+    case triton::arch::ARCH_X86_64:
+      return fn(ArchTraits<triton::arch::ARCH_X86_64>{});
+    case triton::arch::ARCH_AARCH64:
+      return fn(ArchTraits<triton::arch::ARCH_AARCH64>{});
+    default:
+      return fn(ArchTraits<triton::arch::ARCH_INVALID>{});
+  }
+}
+
+// Architecture named `name` (i.e., "x86", "x86_64" or "aarch64", as Binary
+// Ninja names them), `ARCH_INVALID` if it isn't supported
+triton::arch::architecture_e ArchitectureFromName(std::string_view name);
+// Inverse of `ArchitectureFromName`, "unknown" for unsupported architectures
+const char* GetArchitectureName(triton::arch::architecture_e architecture);
+
+}  // namespace triton_bn
@@ -0,0 +1,66 @@
+#include "ast_memory_governor.h"
+
+#include <algorithm>
+
+namespace triton_bn {
+
+AstMemoryGovernor& AstMemoryGovernor::Instance() {
+  static AstMemoryGovernor instance{};
+  return instance;
+}
+
+void AstMemoryGovernor::SetCeiling(uint64_t ceiling_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ceiling_bytes_ = ceiling_bytes;
+  room_available_.notify_all();
+}
+
+void AstMemoryGovernor::Enter() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  room_available_.wait(lock, [this]() {
+    return ceiling_bytes_ == 0 || running_count_ == 0 ||
+           usage_bytes_ + ceiling_bytes_ / kHeadroomDivisor <= ceiling_bytes_;
+  });
+  running_count_++;
+}
+
+bool AstMemoryGovernor::Charge(size_t held_node_count, size_t node_count) {
+  const uint64_t bytes = node_count * kEstimatedAstNodeSize;
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (ceiling_bytes_ != 0 &&
+      held_node_count * kEstimatedAstNodeSize + bytes > ceiling_bytes_) {
+    return false;
+  }
+
+  // Note: Waiting is pointless once every running basic block is, nothing
+  // would ever be released
+  waiting_count_++;
+  room_available_.wait(lock, [&]() {
+    return ceiling_bytes_ == 0 || usage_bytes_ + bytes <= ceiling_bytes_ ||
+           waiting_count_ >= running_count_;
+  });
+  waiting_count_--;
+  usage_bytes_ += bytes;
+  peak_usage_bytes_ = std::max(peak_usage_bytes_, usage_bytes_);
+  return true;
+}
+
+void AstMemoryGovernor::Leave(size_t node_count) {
+  const uint64_t bytes = node_count * kEstimatedAstNodeSize;
+  std::lock_guard<std::mutex> lock(mutex_);
+  usage_bytes_ -= std::min(usage_bytes_, bytes);
+  running_count_--;
+  room_available_.notify_all();
+}
+
+uint64_t AstMemoryGovernor::usage() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return usage_bytes_;
+}
+
+uint64_t AstMemoryGovernor::peak_usage() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return peak_usage_bytes_;
+}
+
+}  // namespace triton_bn
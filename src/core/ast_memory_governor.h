@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace triton_bn {
+
+// Thread-safe, process-wide accounting of the memory held by the symbolic
+// state (ASTs and symbolic expressions) of the basic blocks being simplified,
+// against a ceiling.
+// Basic blocks are only started once there's some headroom left below the
+// ceiling, and wait for others to release memory when they'd push the total
+// past it. A basic block only runs over budget if it would exceed the ceiling
+// on its own, so that the outcome doesn't depend on what runs concurrently.
+// Note: Memory is estimated from the number of AST nodes built, Triton doesn't
+// report its actual usage
+class AstMemoryGovernor {
+ public:
+  // Approximate size of an AST node, along with its share of the symbolic
+  // expression and bookkeeping referring to it
+  static constexpr uint64_t kEstimatedAstNodeSize = 320;
+  // Basic blocks are started while at least 1/8 of the ceiling is free
+  static constexpr uint64_t kHeadroomDivisor = 8;
+
+  static AstMemoryGovernor& Instance();
+
+  // Note: 0 means no ceiling. Basic blocks already running aren't affected.
+  void SetCeiling(uint64_t ceiling_bytes);
+
+  // Wait until there's enough headroom for another basic block. Never waits
+  // if no other basic block is running, so that progress is always made.
+  void Enter();
+  // Account for `node_count` more AST nodes built by the calling basic block,
+  // which already holds `held_node_count`. Waits for other basic blocks to
+  // release memory if the ceiling would be exceeded, unless all of them are
+  // waiting too. Returns false, without accounting them, if the calling basic
+  // block would exceed the ceiling on its own.
+  bool Charge(size_t held_node_count, size_t node_count);
+  // Release the memory accounted for the calling basic block, once its
+  // symbolic state has been freed
+  void Leave(size_t node_count);
+
+  uint64_t usage() const;
+  uint64_t peak_usage() const;
+
+ private:
+  mutable std::mutex mutex_{};
+  std::condition_variable room_available_{};
+  uint64_t ceiling_bytes_ = 0;
+  uint64_t usage_bytes_ = 0;
+  uint64_t peak_usage_bytes_ = 0;
+  size_t running_count_ = 0;
+  // Running basic blocks waiting in `Charge`
+  size_t waiting_count_ = 0;
+};
+
+}  // namespace triton_bn
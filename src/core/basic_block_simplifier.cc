@@ -0,0 +1,577 @@
+#include "basic_block_simplifier.h"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+#include "arch_traits.h"
+#include "instrumentation.h"
+#include "nop_verdict_cache.h"
+
+namespace triton_bn {
+
+template <typename Traits>
+static triton::arch::BasicBlock EliminateDeadStores(
+    const triton::Context& triton, const triton::arch::BasicBlock& triton_bb,
+    const RegisterSet* live_out, const CallSummary* call_summary,
+    bool padding, BudgetTracker* budget);
+template <typename Traits>
+static triton::arch::BasicBlock RemoveSyntacticallyDeadInstructions(
+    const triton::Context& triton, const triton::arch::BasicBlock& triton_bb,
+    bool padding);
+static bool IsNopLikeInstruction(triton::Context& tmp_ctx,
+                                 const triton::arch::Register& pc_reg,
+                                 triton::arch::Instruction& instr);
+static void RestoreInitialSymbolicState(
+    triton::Context& triton, const triton::arch::Instruction& instr);
+static void ReturnFromCall(
+    triton::Context& tmp_ctx, const CallSummary& call_summary,
+    triton::uint512 sp_value,
+    const triton::engines::symbolic::SharedSymbolicExpression& sp_expr);
+static bool SliceExpressions(
+    const std::vector<triton::engines::symbolic::SharedSymbolicExpression>&
+        roots,
+    BudgetTracker* budget, std::unordered_set<triton::usize>& expr_ids);
+static triton::arch::BasicBlock StripSymbolicState(
+    const triton::arch::BasicBlock& triton_bb, uint64_t address,
+    const triton::arch::BasicBlock& original_bb);
+static bool IsDisassembled(const triton::arch::Instruction& instr);
+static void AddNopPadding(triton::arch::BasicBlock& triton_bb,
+                          const triton::arch::Instruction& nop_instr,
+                          triton::uint32 size);
+static uint64_t HashInstructionStream(triton::arch::BasicBlock& triton_bb);
+
+triton::arch::BasicBlock SimplifyTritonBasicBlock(
+    const triton::Context& triton, const triton::arch::BasicBlock& triton_bb,
+    uint64_t address, bool padding, const RegisterSet* live_out,
+    const CallSummary* call_summary, BudgetTracker* budget,
+    size_t max_rounds) {
+  CountEvent(Counter::kSimplifiedBasicBlocks);
+  CountEvent(Counter::kInstructionsIn, triton_bb.getSize());
+
+  triton::arch::BasicBlock simplified_triton_bb = triton_bb;
+  uint64_t previous_hash = HashInstructionStream(simplified_triton_bb);
+  for (size_t round = 0; round < std::max<size_t>(max_rounds, 1); round++) {
+    if (round > 0) {
+      CountEvent(Counter::kExtraSimplificationRounds);
+    }
+
+    triton::arch::BasicBlock round_triton_bb{};
+    {
+      ScopedStageTimer timer(Stage::kTritonSimplification);
+      // Note: Triton's pass can't be stopped once started, it's only used when
+      // nothing else is needed
+      if (live_out != nullptr || call_summary != nullptr ||
+          budget != nullptr) {
+        round_triton_bb =
+            EliminateDeadStores(triton, simplified_triton_bb, live_out,
+                                call_summary, padding, budget);
+      } else {
+        // Note: Triton's pass builds its own context from `triton`
+        CountEvent(Counter::kTritonContexts);
+        round_triton_bb = triton.simplify(simplified_triton_bb, padding);
+      }
+    }
+    const bool over_budget = budget != nullptr && budget->IsExceeded();
+    if (over_budget) {
+      CountEvent(Counter::kOverBudgetBasicBlocks);
+    }
+    if (over_budget && round > 0) {
+      // Keep the result of the previous round
+      break;
+    }
+    if (!over_budget ||
+        budget->budget().fallback == BudgetFallback::kNopLikeRemoval) {
+      ScopedStageTimer timer(Stage::kNopLikeRemoval);
+      round_triton_bb =
+          RemoveNopLikeInstructions(triton, round_triton_bb, padding);
+    }
+    simplified_triton_bb = std::move(round_triton_bb);
+    if (over_budget) {
+      break;
+    }
+
+    // Stop as soon as a round doesn't change anything
+    const uint64_t hash = HashInstructionStream(simplified_triton_bb);
+    if (hash == previous_hash) {
+      break;
+    }
+    previous_hash = hash;
+  }
+  simplified_triton_bb =
+      StripSymbolicState(simplified_triton_bb, address, triton_bb);
+
+  CountEvent(Counter::kInstructionsOut, simplified_triton_bb.getSize());
+  return simplified_triton_bb;
+}
+
+triton::arch::BasicBlock QuickSimplifyTritonBasicBlock(
+    const triton::Context& triton, const triton::arch::BasicBlock& triton_bb,
+    uint64_t address, bool padding) {
+  triton::arch::BasicBlock simplified_triton_bb{};
+  {
+    ScopedStageTimer timer(Stage::kQuickSimplification);
+    simplified_triton_bb =
+        DispatchArchitecture(triton.getArchitecture(), [&](auto traits) {
+          return RemoveSyntacticallyDeadInstructions<decltype(traits)>(
+              triton, triton_bb, padding);
+        });
+    simplified_triton_bb =
+        RemoveNopLikeInstructions(triton, simplified_triton_bb, padding, true);
+  }
+  simplified_triton_bb =
+      StripSymbolicState(simplified_triton_bb, address, triton_bb);
+
+  return simplified_triton_bb;
+}
+
+// Instructions are classified from their type and operands alone, then the
+// basic block is walked backwards while tracking which flags are live. Every
+// flag is considered read after the basic block.
+template <typename Traits>
+static triton::arch::BasicBlock RemoveSyntacticallyDeadInstructions(
+    const triton::Context& triton, const triton::arch::BasicBlock& triton_bb,
+    bool padding) {
+  triton::arch::BasicBlock in = triton_bb;
+  const auto& instructions = in.getInstructions();
+  const triton::uint32 gpr_bit_size = triton.getGprBitSize();
+
+  std::vector<uint8_t> dead_instructions(instructions.size(), 0);
+  bool has_dead_instruction = false;
+  triton::uint32 live_flags = Traits::kAllFlags;
+  for (size_t i = instructions.size(); i-- > 0;) {
+    const auto& instr = instructions[i];
+    if (Traits::IsSyntacticNop(instr, gpr_bit_size)) {
+      dead_instructions[i] = 1;
+      has_dead_instruction = true;
+      continue;
+    }
+
+    const FlagEffects effects = Traits::GetFlagEffects(instr);
+    if (effects.flags_only && effects.defs != 0 &&
+        (effects.defs & live_flags) == 0) {
+      // Flags overwritten before being read
+      dead_instructions[i] = 1;
+      has_dead_instruction = true;
+      continue;
+    }
+    live_flags = (live_flags & ~effects.defs) | effects.uses;
+  }
+  if (!has_dead_instruction) {
+    return triton_bb;
+  }
+
+  const auto nop_instr = triton.getNopInstruction();
+  triton::arch::BasicBlock out;
+  for (size_t i = 0; i < instructions.size(); i++) {
+    const auto& instr = instructions[i];
+    if (!dead_instructions[i]) {
+      out.add(instr);
+    } else if (padding) {
+      AddNopPadding(out, nop_instr, instr.getSize());
+    }
+  }
+
+  return out;
+}
+
+// The basic block is executed in a new context, then every instruction that
+// contributed to a store, to a call or to the final value of a live register
+// is kept.
+// If an instruction can't be executed, this falls back to Triton's own pass,
+// or leaves the basic block untouched when calls are summarized (Triton
+// would treat them as jumps) or when `budget` is set (Triton's pass can't be
+// stopped).
+triton::arch::BasicBlock EliminateDeadStores(
+    const triton::Context& triton, const triton::arch::BasicBlock& triton_bb,
+    const RegisterSet* live_out, const CallSummary* call_summary,
+    bool padding, BudgetTracker* budget) {
+  return DispatchArchitecture(triton.getArchitecture(), [&](auto traits) {
+    return EliminateDeadStores<decltype(traits)>(
+        triton, triton_bb, live_out, call_summary, padding, budget);
+  });
+}
+
+// `EliminateDeadStores`, specialized for the architecture of `triton`
+template <typename Traits>
+static triton::arch::BasicBlock EliminateDeadStores(
+    const triton::Context& triton, const triton::arch::BasicBlock& triton_bb,
+    const RegisterSet* live_out, const CallSummary* call_summary,
+    bool padding, BudgetTracker* budget) {
+  triton::arch::BasicBlock in = triton_bb;
+  triton::arch::BasicBlock out;
+
+  triton::Context tmp_ctx(triton.getArchitecture());
+  CountEvent(Counter::kTritonContexts);
+  const auto& sp_reg = tmp_ctx.getStackPointer();
+
+  // Expressions the live state depends on
+  std::vector<triton::engines::symbolic::SharedSymbolicExpression> roots{};
+  for (auto& instr : in.getInstructions()) {
+    const bool is_call = call_summary != nullptr && Traits::IsCall(instr);
+    const auto sp_value = tmp_ctx.getConcreteRegisterValue(sp_reg);
+    const auto sp_expr = tmp_ctx.getSymbolicRegister(sp_reg);
+
+    if (tmp_ctx.processing(instr) != triton::arch::NO_FAULT) {
+      if (call_summary != nullptr || budget != nullptr) {
+        return triton_bb;
+      }
+      CountEvent(Counter::kTritonContexts);
+      return triton.simplify(triton_bb, padding);
+    }
+    if (budget != nullptr && !budget->Charge(instr)) {
+      return triton_bb;
+    }
+    if (is_call) {
+      // The callee may read its arguments and any memory
+      for (const auto& [reg_id, expr] : tmp_ctx.getSymbolicRegisters()) {
+        if (call_summary->argument_registers.Contains(reg_id)) {
+          roots.push_back(expr);
+        }
+      }
+      for (const auto& [address, expr] : tmp_ctx.getSymbolicMemory()) {
+        roots.push_back(expr);
+      }
+      ReturnFromCall(tmp_ctx, *call_summary, sp_value, sp_expr);
+    }
+  }
+
+  for (const auto& [reg_id, expr] : tmp_ctx.getSymbolicRegisters()) {
+    if (live_out == nullptr || live_out->Contains(reg_id)) {
+      roots.push_back(expr);
+    }
+  }
+  for (const auto& [address, expr] : tmp_ctx.getSymbolicMemory()) {
+    roots.push_back(expr);
+  }
+  std::unordered_set<triton::usize> useful_expr_ids{};
+  if (!SliceExpressions(roots, budget, useful_expr_ids)) {
+    return triton_bb;
+  }
+
+  const auto nop_instr = triton.getNopInstruction();
+  for (const auto& instr : in.getInstructions()) {
+    bool useful = instr.isControlFlow();
+    for (const auto& expr : instr.symbolicExpressions) {
+      if (useful) {
+        break;
+      }
+      useful = useful_expr_ids.find(expr->getId()) !=
+               std::cend(useful_expr_ids);
+    }
+
+    if (useful) {
+      out.add(instr);
+    } else if (padding) {
+      AddNopPadding(out, nop_instr, instr.getSize());
+    }
+  }
+
+  return out;
+}
+
+// Add the IDs of `roots` and of the expressions they depend on to `expr_ids`,
+// same as Triton's `sliceExpressions` for each of them, except that
+// expressions already in `expr_ids` aren't walked again.
+// Note: The time limit of `budget` (if not null) is checked while walking,
+// returns false once it's exceeded
+static bool SliceExpressions(
+    const std::vector<triton::engines::symbolic::SharedSymbolicExpression>&
+        roots,
+    BudgetTracker* budget, std::unordered_set<triton::usize>& expr_ids) {
+  // Number of nodes visited between two checks of the time limit
+  constexpr size_t kBudgetCheckInterval = 1024;
+
+  std::vector<triton::ast::AbstractNode*> pending_nodes{};
+  size_t visited_count = 0;
+  for (const auto& root : roots) {
+    if (!expr_ids.insert(root->getId()).second) {
+      // Already part of another slice
+      continue;
+    }
+    pending_nodes.push_back(root->getAst().get());
+    while (!pending_nodes.empty()) {
+      if (budget != nullptr && ++visited_count % kBudgetCheckInterval == 0 &&
+          !budget->Check()) {
+        return false;
+      }
+      triton::ast::AbstractNode* node = pending_nodes.back();
+      pending_nodes.pop_back();
+      if (node == nullptr) {
+        continue;
+      }
+      if (node->getType() == triton::ast::REFERENCE_NODE) {
+        const auto& expr = reinterpret_cast<triton::ast::ReferenceNode*>(node)
+                               ->getSymbolicExpression();
+        if (expr_ids.insert(expr->getId()).second) {
+          pending_nodes.push_back(expr->getAst().get());
+        }
+        continue;
+      }
+      for (const auto& child : node->getChildren()) {
+        pending_nodes.push_back(child.get());
+      }
+    }
+  }
+
+  return budget == nullptr || budget->Check();
+}
+
+// Update the state of `tmp_ctx`, right after a call instruction has been
+// executed, as if the callee had returned: the stack pointer is restored
+// (`sp_value` and `sp_expr` are from before the call) and clobbered registers
+// get new, unrelated values.
+static void ReturnFromCall(
+    triton::Context& tmp_ctx, const CallSummary& call_summary,
+    triton::uint512 sp_value,
+    const triton::engines::symbolic::SharedSymbolicExpression& sp_expr) {
+  const auto& sp_reg = tmp_ctx.getStackPointer();
+  tmp_ctx.setConcreteRegisterValue(sp_reg, sp_value);
+  if (sp_expr != nullptr) {
+    tmp_ctx.assignSymbolicExpressionToRegister(sp_expr, sp_reg);
+  } else {
+    tmp_ctx.concretizeRegister(sp_reg);
+  }
+
+  for (const auto* reg : tmp_ctx.getParentRegisters()) {
+    if (call_summary.clobbered_registers.Contains(reg->getId())) {
+      tmp_ctx.symbolizeRegister(*reg);
+    }
+  }
+}
+
+// Copy the instructions of a basic block without the symbolic expressions
+// and ASTs they've accumulated while being executed, which would otherwise keep
+// the whole symbolic state of the simplification alive. The copies are laid
+// out one after the other from `address`.
+// Copies that end up where `original_bb` had the same encoding reuse its
+// decoded instruction, the others only get their encoding and address. See
+// `DisassembleTritonBasicBlock`.
+// Note: `original_bb`'s instructions must not hold any symbolic state (i.e.,
+// they've only been disassembled)
+static triton::arch::BasicBlock StripSymbolicState(
+    const triton::arch::BasicBlock& triton_bb, uint64_t address,
+    const triton::arch::BasicBlock& original_bb) {
+  triton::arch::BasicBlock in = triton_bb;
+  triton::arch::BasicBlock original = original_bb;
+  const auto& original_instructions = original.getInstructions();
+  triton::arch::BasicBlock out;
+  // Note: Both basic blocks are sorted by address, instructions can only move
+  // backwards when others are removed
+  size_t original_index = 0;
+  for (const auto& instr : in.getInstructions()) {
+    while (original_index < original_instructions.size() &&
+           original_instructions[original_index].getAddress() < address) {
+      original_index++;
+    }
+    if (original_index < original_instructions.size()) {
+      const auto& original_instr = original_instructions[original_index];
+      if (original_instr.getAddress() == address &&
+          original_instr.getSize() == instr.getSize() &&
+          std::memcmp(original_instr.getOpcode(), instr.getOpcode(),
+                      instr.getSize()) == 0) {
+        out.add(original_instr);
+        address += instr.getSize();
+        continue;
+      }
+    }
+
+    out.add(triton::arch::Instruction(address, instr.getOpcode(),
+                                      instr.getSize()));
+    address += instr.getSize();
+  }
+
+  return out;
+}
+
+// Note: Triton only sets the type of instructions when disassembling them, and
+// 0 is the invalid type of all architectures
+static bool IsDisassembled(const triton::arch::Instruction& instr) {
+  return instr.getType() != 0;
+}
+
+// Polynomial rolling hash of the encodings of a basic block's instructions,
+// used to detect that a simplification round didn't change anything
+static uint64_t HashInstructionStream(triton::arch::BasicBlock& triton_bb) {
+  constexpr uint64_t kBase = 0x100000001b3ULL;
+  uint64_t hash = triton_bb.getSize();
+  for (const auto& instr : triton_bb.getInstructions()) {
+    const uint8_t* opcode = instr.getOpcode();
+    for (uint32_t i = 0; i < instr.getSize(); i++) {
+      hash = hash * kBase + opcode[i] + 1;
+    }
+    // Separate instructions, so that different splits of the same bytes don't
+    // collide
+    hash = hash * kBase;
+  }
+
+  return hash;
+}
+
+// Instructions are disassembled one by one, so that those that already are
+// don't have to be decoded again.
+void DisassembleTritonBasicBlock(const triton::Context& triton,
+                                 triton::arch::BasicBlock& triton_bb) {
+  ScopedStageTimer timer(Stage::kDisassembly);
+  for (auto& instr : triton_bb.getInstructions()) {
+    if (!IsDisassembled(instr)) {
+      triton.disassembly(instr);
+      CountEvent(Counter::kInstructionsDisassembledForDisplay);
+    }
+  }
+}
+
+// Function inspired from Triton's DSE utility.
+// This function looks for instruction that behave like NOP instructions and
+// removes them from the given basic block and returns a new basic block as a
+// result.
+// Each instruction is executed on top of the same initial state (all registers
+// symbolized, memory concrete), which is set up once for the whole basic block
+// and restored after each instruction by only resetting what the instruction
+// modified. Verdicts are cached by encoding, see `NopVerdictCache`.
+// When `cached_only` is true, instructions without a cached verdict are kept
+// and nothing is executed.
+triton::arch::BasicBlock RemoveNopLikeInstructions(
+    const triton::Context& triton, const triton::arch::BasicBlock& triton_bb,
+    bool padding, bool cached_only) {
+  triton::arch::BasicBlock in = triton_bb;
+  triton::arch::BasicBlock out;
+
+  // Note: `triton`'s registers are only used to identify them in `tmp_ctx`
+  const auto nop_instr = triton.getNopInstruction();
+  const auto& pc_reg = triton.getProgramCounter();
+
+  // Note: The symbolic state is only set up once a verdict isn't found in the
+  // cache
+  std::optional<triton::Context> tmp_ctx{};
+  NopVerdictCache& verdict_cache = NopVerdictCache::Instance();
+
+  for (auto& instr : in.getInstructions()) {
+    const auto cache_key =
+        NopVerdictCache::MakeKey(triton.getArchitecture(), instr);
+    std::optional<bool> is_nop_like = verdict_cache.Lookup(cache_key);
+    if (!is_nop_like.has_value() && cached_only) {
+      out.add(instr);
+      continue;
+    }
+    if (!is_nop_like.has_value()) {
+      if (!tmp_ctx.has_value()) {
+        tmp_ctx.emplace(triton.getArchitecture());
+        CountEvent(Counter::kTritonContexts);
+        // Symbolize all registers
+        for (auto& [reg_t, reg] : tmp_ctx->getAllRegisters()) {
+          tmp_ctx->symbolizeRegister(reg);
+        }
+      }
+
+      is_nop_like = IsNopLikeInstruction(*tmp_ctx, pc_reg, instr);
+      verdict_cache.Insert(cache_key, *is_nop_like);
+    }
+
+    // Check instruction's side effects
+    if (*is_nop_like) {
+      // Instruction has no side effects, get rid of it
+      if (padding) {
+        AddNopPadding(out, nop_instr, instr.getSize());
+      }
+    } else {
+      // Instruction has side effects, keep it in the basic block
+      out.add(instr);
+    }
+  }
+
+  return out;
+}
+
+// Execute the given instruction symbolically on top of the state set up by
+// `RemoveNopLikeInstructions` and check whether it modified the CPU or memory
+// state meaningfully
+static bool IsNopLikeInstruction(triton::Context& tmp_ctx,
+                                 const triton::arch::Register& pc_reg,
+                                 triton::arch::Instruction& instr) {
+  // Concretize RIP
+  const auto instruction_addr = instr.getAddress();
+  tmp_ctx.setConcreteRegisterValue(pc_reg, instruction_addr);
+
+  // Execute instruction symbolically
+  tmp_ctx.processing(instr);
+  const auto post_instruction_addr = tmp_ctx.getConcreteRegisterValue(pc_reg);
+
+  // Iterate over all symbolic expressions generated by the instruction and
+  // keep only those which modified the CPU or memory state meaningfully
+  std::vector<triton::engines::symbolic::SharedSymbolicExpression>
+      effectual_symbolic_expressions;
+  for (const auto& expr : instr.symbolicExpressions) {
+    // Check for PC being assigned the value of the instruction located right
+    // after the one we executed
+    if (expr->getOriginRegister().getId() == pc_reg.getId()) {
+      if (post_instruction_addr > instruction_addr &&
+          post_instruction_addr - instruction_addr == instr.getSize()) {
+        // Instruction doesn't "jump around", ignore PC-related assignment
+        continue;
+      }
+    }
+
+    // Check for same-register assignments
+    if (expr->isRegister()) {
+      const auto& lhs_origin_reg = expr->getOriginRegister();
+      if (expr->getAst()->getType() == triton::ast::REFERENCE_NODE) {
+        auto* reference_node = reinterpret_cast<triton::ast::ReferenceNode*>(
+            expr->getAst().get());
+        const auto& rhs_origin_reg =
+            reference_node->getSymbolicExpression()->getOriginRegister();
+        if (lhs_origin_reg.getId() == rhs_origin_reg.getId()) {
+          // Both sides of the assignment contain the same symbolic register,
+          // ignore
+          continue;
+        }
+      }
+    }
+
+    effectual_symbolic_expressions.push_back(expr);
+  }
+  RestoreInitialSymbolicState(tmp_ctx, instr);
+
+  return effectual_symbolic_expressions.empty();
+}
+
+// Undo the changes made by the given instruction to the state set up by
+// `RemoveNopLikeInstructions`, so that the next instruction is executed as if
+// it were executed in a brand new context
+static void RestoreInitialSymbolicState(
+    triton::Context& triton, const triton::arch::Instruction& instr) {
+  std::unordered_set<triton::arch::register_e> modified_registers{};
+  for (const auto& expr : instr.symbolicExpressions) {
+    if (expr->isRegister()) {
+      modified_registers.insert(
+          triton.getParentRegister(expr->getOriginRegister()).getId());
+    } else if (expr->isMemory()) {
+      // Note: Memory isn't symbolized initially
+      const auto& mem = expr->getOriginMemory();
+      triton.concretizeMemory(mem);
+      triton.clearConcreteMemoryValue(mem);
+    }
+  }
+
+  for (const auto reg_id : modified_registers) {
+    const auto& reg = triton.getRegister(reg_id);
+    triton.setConcreteRegisterValue(reg, 0);
+    triton.symbolizeRegister(reg);
+  }
+}
+
+// Append `nop_instr` to `triton_bb` until it covers `size` bytes, to replace
+// a removed instruction of that size
+static void AddNopPadding(triton::arch::BasicBlock& triton_bb,
+                          const triton::arch::Instruction& nop_instr,
+                          triton::uint32 size) {
+  triton::uint32 padding_size = 0;
+  while (size > padding_size) {
+    triton_bb.add(nop_instr);
+    padding_size += nop_instr.getSize();
+  }
+}
+
+}  // namespace triton_bn
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <triton/basicBlock.hpp>
+#include <triton/context.hpp>
+
+#include "call_summary.h"
+#include "liveness.h"
+#include "simplification_budget.h"
+
+namespace triton_bn {
+
+// Simplify a single Triton basic block located at `address`: Triton's dead
+// store elimination pass is applied first, then NOP-like instructions are
+// removed. The resulting instructions don't hold any symbolic state, and are
+// only disassembled if they're unchanged: patching only needs their encoding
+// and address, see `DisassembleTritonBasicBlock` to display them.
+// When `live_out` is given, registers that aren't part of it are considered
+// dead at the end of the basic block. When `call_summary` is given, the basic
+// block may contain calls. See `EliminateDeadStores`.
+// When `budget` is given and runs out during dead store elimination, the
+// basic block is left as is, apart from NOP-like instruction removal if the
+// budget's fallback asks for it. `budget->IsExceeded()` tells if it happened.
+// Removing instructions can expose new dead stores, both passes are repeated
+// until a round doesn't change anything, `max_rounds` times at most. The
+// budget is shared by all rounds, the result of the previous round is kept if
+// it runs out after the first one.
+// Note: This doesn't depend on "Binary Ninja", so that it can be used outside
+// of the plugin (e.g., by benchmarks). Throws `triton::exceptions::Exception`
+// on failure.
+triton::arch::BasicBlock SimplifyTritonBasicBlock(
+    const triton::Context& triton, const triton::arch::BasicBlock& triton_bb,
+    uint64_t address, bool padding, const RegisterSet* live_out = nullptr,
+    const CallSummary* call_summary = nullptr,
+    BudgetTracker* budget = nullptr, size_t max_rounds = 1);
+
+// Cheaper alternative to `SimplifyTritonBasicBlock`, meant to give a quick
+// preview: nothing is executed. NOPs and moves of a register to itself are
+// removed, and so are comparisons whose flags are overwritten before being
+// read (see `ArchTraits<>::GetFlagEffects`), then instructions
+// `NopVerdictCache` already knows to be NOP-like.
+triton::arch::BasicBlock QuickSimplifyTritonBasicBlock(
+    const triton::Context& triton, const triton::arch::BasicBlock& triton_bb,
+    uint64_t address, bool padding);
+
+// Same as Triton's dead store elimination pass, except that only the registers
+// in `live_out` (and memory) are considered used after the basic block, instead
+// of all of them (if null), and that calls are modeled after `call_summary`
+// (if not null) instead of being treated as jumps.
+// The basic block is returned as is if `budget` (if not null) runs out, or if
+// an instruction can't be executed while it's set.
+triton::arch::BasicBlock EliminateDeadStores(
+    const triton::Context& triton, const triton::arch::BasicBlock& triton_bb,
+    const RegisterSet* live_out, const CallSummary* call_summary,
+    bool padding = false, BudgetTracker* budget = nullptr);
+
+// Disassemble the instructions of a simplified basic block that haven't been
+// yet (see `SimplifyTritonBasicBlock`), so that their text can be displayed.
+// Note: Throws `triton::exceptions::Exception` on failure
+void DisassembleTritonBasicBlock(const triton::Context& triton,
+                                 triton::arch::BasicBlock& triton_bb);
+
+// Remove instructions that have no effect on the CPU or memory state. Removed
+// instructions are replaced with NOP instructions of the same size when
+// `padding` is true. Only cached verdicts are used if `cached_only` is true.
+triton::arch::BasicBlock RemoveNopLikeInstructions(
+    const triton::Context& triton, const triton::arch::BasicBlock& triton_bb,
+    bool padding = false, bool cached_only = false);
+
+}  // namespace triton_bn
@@ -0,0 +1,15 @@
+#include "call_summary.h"
+
+#include "arch_traits.h"
+
+namespace triton_bn {
+
+// Note: Loops over instructions should dispatch on the architecture once and
+// use `ArchTraits<>::IsCall` instead
+bool IsCallInstruction(const triton::arch::Instruction& instr) {
+  return DispatchArchitecture(instr.getArchitecture(), [&](auto traits) {
+    return decltype(traits)::IsCall(instr);
+  });
+}
+
+}  // namespace triton_bn
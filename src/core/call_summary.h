@@ -0,0 +1,25 @@
+#pragma once
+
+#include <triton/context.hpp>
+#include <triton/instruction.hpp>
+
+#include "liveness.h"
+
+namespace triton_bn {
+
+// Effects of calls on registers, as described by a calling convention. It
+// lets basic blocks be simplified across calls, instead of being split at
+// each of them.
+// Note: Registers that aren't clobbered are preserved across calls. Calls are
+// assumed to return with the stack pointer they were made with (i.e., the
+// callee doesn't pop its arguments), and to read any memory.
+struct CallSummary {
+  // Registers callees may read (e.g., arguments)
+  RegisterSet argument_registers{};
+  // Registers callees may overwrite (e.g., caller-saved registers, flags)
+  RegisterSet clobbered_registers{};
+};
+
+bool IsCallInstruction(const triton::arch::Instruction& instr);
+
+}  // namespace triton_bn
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+namespace triton_bn {
+
+// Note: Mirrors "Binary Ninja"'s branch types
+enum class BranchType : uint8_t {
+  kUnconditional,
+  kFalse,
+  kTrue,
+  kCall,
+  kReturn,
+  kSystemCall,
+  kIndirect,
+  kException,
+  kUnresolved,
+  kUserDefined,
+};
+
+constexpr uint32_t kInvalidBlockIndex = std::numeric_limits<uint32_t>::max();
+
+// Plain description of a function's control flow graph, used as input by the
+// simplification pipeline.
+// Basic blocks are identified by their index and their attributes are stored
+// in parallel arrays. Edges are stored contiguously, grouped by source basic
+// block, so that the whole graph only takes a handful of allocations whatever
+// its size.
+struct ControlFlowGraph {
+  uint64_t function_start = 0;
+
+  // Basic blocks' attributes
+  std::vector<uint64_t> block_starts{};
+  std::vector<uint64_t> block_ends{};
+  std::vector<uint32_t> incoming_edge_counts{};
+
+  // The outgoing edges of basic block `i` are located in
+  // [edge_offsets[i], edge_offsets[i + 1]) in the edges' arrays
+  std::vector<uint32_t> edge_offsets{0};
+  // Index of the target basic block, or `kInvalidBlockIndex` if the target
+  // isn't part of the graph
+  std::vector<uint32_t> edge_targets{};
+  std::vector<BranchType> edge_types{};
+
+  size_t block_count() const { return block_starts.size(); }
+  size_t edge_count() const { return edge_targets.size(); }
+
+  uint32_t edges_begin(uint32_t block_index) const {
+    return edge_offsets[block_index];
+  }
+  uint32_t edges_end(uint32_t block_index) const {
+    return edge_offsets[block_index + 1];
+  }
+
+  void Reserve(size_t block_count, size_t edge_count) {
+    block_starts.reserve(block_count);
+    block_ends.reserve(block_count);
+    incoming_edge_counts.reserve(block_count);
+    edge_offsets.reserve(block_count + 1);
+    edge_targets.reserve(edge_count);
+    edge_types.reserve(edge_count);
+  }
+
+  // Append a basic block and return its index.
+  // Note: Outgoing edges are added to the last basic block, so blocks must be
+  // added along with their edges, in order.
+  uint32_t AddBasicBlock(uint64_t start, uint64_t end) {
+    block_starts.push_back(start);
+    block_ends.push_back(end);
+    incoming_edge_counts.push_back(0);
+    edge_offsets.push_back(edge_offsets.back());
+    return static_cast<uint32_t>(block_starts.size() - 1);
+  }
+
+  void AddOutgoingEdge(BranchType type, uint32_t target = kInvalidBlockIndex) {
+    edge_types.push_back(type);
+    edge_targets.push_back(target);
+    edge_offsets.back()++;
+  }
+};
+
+// Set the incoming edge count of every basic block from the outgoing edges of
+// the graph.
+// Note: Only valid when all the incoming edges come from the graph itself.
+inline void CountIncomingEdges(ControlFlowGraph& cfg) {
+  std::fill(std::begin(cfg.incoming_edge_counts),
+            std::end(cfg.incoming_edge_counts), 0);
+  for (const uint32_t target : cfg.edge_targets) {
+    if (target != kInvalidBlockIndex) {
+      cfg.incoming_edge_counts[target]++;
+    }
+  }
+}
+
+}  // namespace triton_bn
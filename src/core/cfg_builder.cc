@@ -0,0 +1,283 @@
+#include "cfg_builder.h"
+
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "arch_traits.h"
+#include "instrumentation.h"
+#include "log.h"
+
+namespace triton_bn {
+
+namespace {
+
+// How an instruction affects the control flow
+enum class InstructionFlow : uint8_t {
+  kSequential,
+  kCall,
+  kBranch,
+  kConditionalBranch,
+  kIndirectBranch,
+  kReturn,
+  // Stops the execution (e.g., `hlt`, `ud2`)
+  kTrap,
+};
+
+// Note: Only what's needed to build the graph is kept, so that large functions
+// don't hold on to Triton instructions
+struct DecodedInstruction {
+  uint64_t address = 0;
+  uint32_t size = 0;
+  InstructionFlow flow = InstructionFlow::kSequential;
+  bool has_target = false;
+  uint64_t target = 0;
+};
+
+using ClassifyInstructionFn =
+    InstructionFlow (*)(const triton::arch::Instruction& instr);
+
+}  // namespace
+
+static bool DecodeInstruction(const CodeSource& code, uint64_t address,
+                              triton::Context& triton,
+                              ClassifyInstructionFn classify_instruction,
+                              DecodedInstruction& decoded_instr);
+template <typename Traits>
+static InstructionFlow ClassifyInstruction(
+    const triton::arch::Instruction& instr);
+static bool GetBranchTarget(const triton::arch::Instruction& instr,
+                            uint64_t& target);
+
+ControlFlowGraph RecoverControlFlowGraph(const CodeSource& code,
+                                         uint64_t function_start,
+                                         triton::Context& triton) {
+  ScopedStageTimer timer(Stage::kCfgRecovery);
+  ControlFlowGraph cfg{};
+  cfg.function_start = function_start;
+  const auto classify_instruction =
+      DispatchArchitecture(triton.getArchitecture(), [](auto traits) {
+        return ClassifyInstructionFn{&ClassifyInstruction<decltype(traits)>};
+      });
+
+  // Decode all reachable instructions, each address is decoded once
+  std::vector<DecodedInstruction> instructions{};
+  // Address -> index in `instructions`
+  std::unordered_map<uint64_t, uint32_t> instruction_indexes{};
+  // Start addresses of basic blocks
+  std::unordered_set<uint64_t> leaders{};
+  std::vector<uint64_t> pending_addresses{};
+  auto add_leader = [&](uint64_t address) {
+    if (leaders.insert(address).second) {
+      pending_addresses.push_back(address);
+    }
+  };
+
+  add_leader(function_start);
+  while (!pending_addresses.empty()) {
+    uint64_t address = pending_addresses.back();
+    pending_addresses.pop_back();
+
+    // Decode linearly until the control flow stops
+    for (;;) {
+      if (instruction_indexes.find(address) != std::cend(instruction_indexes)) {
+        // Flowing into known code, which must start a basic block
+        leaders.insert(address);
+        break;
+      }
+
+      DecodedInstruction instr{};
+      if (!DecodeInstruction(code, address, triton, classify_instruction,
+                             instr)) {
+        break;
+      }
+      instruction_indexes.emplace(address,
+                                  static_cast<uint32_t>(instructions.size()));
+      instructions.push_back(instr);
+
+      const uint64_t next_address = address + instr.size;
+      if (instr.flow == InstructionFlow::kSequential ||
+          instr.flow == InstructionFlow::kCall) {
+        address = next_address;
+        continue;
+      }
+      if (instr.has_target) {
+        add_leader(instr.target);
+      }
+      if (instr.flow == InstructionFlow::kConditionalBranch) {
+        add_leader(next_address);
+      }
+      break;
+    }
+  }
+
+  // Basic blocks are ordered by address
+  std::vector<uint64_t> block_starts{};
+  for (const uint64_t leader : leaders) {
+    if (instruction_indexes.find(leader) != std::cend(instruction_indexes)) {
+      block_starts.push_back(leader);
+    }
+  }
+  std::sort(std::begin(block_starts), std::end(block_starts));
+  if (block_starts.empty()) {
+    LogMessage(LogLevel::kError, "Failed to decode function at 0x%p",
+               (void*)function_start);
+    return cfg;
+  }
+
+  // Note: CFG indexes are positions in `block_starts`
+  auto find_block = [&block_starts](uint64_t address) {
+    const auto it = std::lower_bound(std::cbegin(block_starts),
+                                     std::cend(block_starts), address);
+    if (it == std::cend(block_starts) || *it != address) {
+      return kInvalidBlockIndex;
+    }
+    return static_cast<uint32_t>(it - std::cbegin(block_starts));
+  };
+
+  cfg.Reserve(block_starts.size(), block_starts.size() * 2);
+  for (const uint64_t block_start : block_starts) {
+    // Walk through the block until its last instruction
+    const DecodedInstruction* instr =
+        &instructions[instruction_indexes[block_start]];
+    bool falls_through = false;
+    for (;;) {
+      if (instr->flow != InstructionFlow::kSequential &&
+          instr->flow != InstructionFlow::kCall) {
+        break;
+      }
+      const uint64_t next_address = instr->address + instr->size;
+      const auto next_it = instruction_indexes.find(next_address);
+      if (next_it == std::cend(instruction_indexes)) {
+        // Couldn't decode further
+        break;
+      }
+      if (leaders.find(next_address) != std::cend(leaders)) {
+        // Fall-through into the next basic block
+        falls_through = true;
+        break;
+      }
+      instr = &instructions[next_it->second];
+    }
+    const uint64_t next_address = instr->address + instr->size;
+    cfg.AddBasicBlock(block_start, next_address);
+
+    if (falls_through) {
+      cfg.AddOutgoingEdge(BranchType::kUnconditional, find_block(next_address));
+      continue;
+    }
+    switch (instr->flow) {
+      case InstructionFlow::kBranch:
+        cfg.AddOutgoingEdge(BranchType::kUnconditional,
+                            find_block(instr->target));
+        break;
+      case InstructionFlow::kConditionalBranch:
+        if (instr->has_target) {
+          cfg.AddOutgoingEdge(BranchType::kTrue, find_block(instr->target));
+        }
+        cfg.AddOutgoingEdge(BranchType::kFalse, find_block(next_address));
+        break;
+      case InstructionFlow::kIndirectBranch:
+        cfg.AddOutgoingEdge(BranchType::kUnresolved);
+        break;
+      default:
+        break;
+    }
+  }
+  CountIncomingEdges(cfg);
+
+  LogMessage(LogLevel::kDebug,
+             "%zu basic block(s) recovered from %zu instruction(s) at 0x%p",
+             cfg.block_count(), instructions.size(),
+             (void*)function_start);
+  return cfg;
+}
+
+static bool DecodeInstruction(const CodeSource& code, uint64_t address,
+                              triton::Context& triton,
+                              ClassifyInstructionFn classify_instruction,
+                              DecodedInstruction& decoded_instr) {
+  uint8_t instr_data[kMaxInstructionSize];
+  const size_t max_instr_size =
+      code.Read(address, instr_data, sizeof(instr_data));
+  if (max_instr_size == 0) {
+    return false;
+  }
+
+  // Note: Triton sets the instruction's actual size when disassembling it
+  triton::arch::Instruction instr(address, instr_data,
+                                  static_cast<uint32_t>(max_instr_size));
+  try {
+    triton.disassembly(instr);
+  } catch (triton::exceptions::Exception& ex) {
+    LogMessage(LogLevel::kWarning,
+               "Failed to disassemble instruction at address 0x%p",
+               (void*)address);
+    return false;
+  }
+  if (instr.getSize() == 0) {
+    LogMessage(LogLevel::kWarning,
+               "Failed to decode instruction at address 0x%p",
+               (void*)address);
+    return false;
+  }
+
+  decoded_instr.address = address;
+  decoded_instr.size = instr.getSize();
+  decoded_instr.flow = classify_instruction(instr);
+  if (decoded_instr.flow == InstructionFlow::kBranch ||
+      decoded_instr.flow == InstructionFlow::kConditionalBranch) {
+    decoded_instr.has_target = GetBranchTarget(instr, decoded_instr.target);
+    if (!decoded_instr.has_target &&
+        decoded_instr.flow == InstructionFlow::kBranch) {
+      decoded_instr.flow = InstructionFlow::kIndirectBranch;
+    }
+  }
+
+  return true;
+}
+
+// Note: Specialized for each architecture, instructions are classified from
+// the type Triton gives them
+template <typename Traits>
+static InstructionFlow ClassifyInstruction(
+    const triton::arch::Instruction& instr) {
+  // Note: Traps aren't flagged as control flow instructions
+  if (Traits::IsTrap(instr)) {
+    return InstructionFlow::kTrap;
+  }
+  if (!instr.isControlFlow()) {
+    return InstructionFlow::kSequential;
+  }
+
+  if (Traits::IsCall(instr)) {
+    return InstructionFlow::kCall;
+  }
+  if (Traits::IsReturn(instr)) {
+    return InstructionFlow::kReturn;
+  }
+  if (Traits::IsJump(instr)) {
+    return InstructionFlow::kBranch;
+  }
+  if (Traits::IsConditionalBranch(instr)) {
+    return InstructionFlow::kConditionalBranch;
+  }
+  return InstructionFlow::kSequential;
+}
+
+// Note: Direct branches have their target as last operand, for all supported
+// architectures (e.g., `jne 0x401000`, `tbz x0, #3, #0x401000`)
+static bool GetBranchTarget(const triton::arch::Instruction& instr,
+                            uint64_t& target) {
+  if (instr.operands.empty() ||
+      instr.operands.back().getType() != triton::arch::OP_IMM) {
+    return false;
+  }
+
+  target = instr.operands.back().getConstImmediate().getValue();
+  return true;
+}
+
+}  // namespace triton_bn
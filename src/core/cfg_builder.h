@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <triton/context.hpp>
+
+#include "cfg.h"
+#include "code_source.h"
+
+namespace triton_bn {
+
+// Recover the control flow graph of the function starting at `function_start`
+// by recursive descent over Triton's disassembler, for when no analyzer is
+// available to provide it.
+// The graph has the same shape as the ones given by "Binary Ninja": calls don't
+// end basic blocks (extraction splits them), conditional branches have a true
+// and a false edge, and blocks that fall through into another block get an
+// unconditional edge to it. Branches to unknown locations get untargeted
+// edges.
+// Returns a graph without basic blocks if the entry point can't be decoded.
+ControlFlowGraph RecoverControlFlowGraph(const CodeSource& code,
+                                         uint64_t function_start,
+                                         triton::Context& triton);
+
+}  // namespace triton_bn
@@ -0,0 +1,52 @@
+#include "code_source.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace triton_bn {
+
+void MemoryCodeSource::AddRange(uint64_t address, const uint8_t* data,
+                                size_t size) {
+  const auto it = std::upper_bound(
+      std::begin(ranges_), std::end(ranges_), address,
+      [](uint64_t address, const Range& range) {
+        return address < range.address;
+      });
+  ranges_.insert(it, {address, data, size});
+}
+
+// Note: Reads can span several adjacent ranges
+size_t MemoryCodeSource::Read(uint64_t address, void* dest,
+                              size_t size) const {
+  auto* output = static_cast<uint8_t*>(dest);
+  size_t read_size = 0;
+
+  // Find the range containing `address`
+  auto it = std::upper_bound(std::cbegin(ranges_), std::cend(ranges_), address,
+                             [](uint64_t address, const Range& range) {
+                               return address < range.address;
+                             });
+  if (it == std::cbegin(ranges_)) {
+    return 0;
+  }
+  --it;
+
+  while (read_size < size && it != std::cend(ranges_)) {
+    const uint64_t cur_address = address + read_size;
+    if (cur_address < it->address || cur_address >= it->address + it->size) {
+      // Not mapped
+      break;
+    }
+
+    const size_t offset = cur_address - it->address;
+    const size_t chunk_size = std::min(size - read_size, it->size - offset);
+    std::memcpy(output + read_size, it->data + offset, chunk_size);
+    read_size += chunk_size;
+    ++it;
+  }
+
+  return read_size;
+}
+
+}  // namespace triton_bn
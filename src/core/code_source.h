@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace triton_bn {
+
+// Note: Long enough for all supported architectures
+constexpr size_t kMaxInstructionSize = 16;
+
+// Gives access to the bytes of the code being simplified.
+// Note: Implementations must support concurrent reads.
+class CodeSource {
+ public:
+  virtual ~CodeSource() = default;
+
+  // Read up to `size` bytes located at `address` into `dest`. Returns the
+  // number of bytes actually read.
+  virtual size_t Read(uint64_t address, void* dest, size_t size) const = 0;
+};
+
+// Code source backed by byte ranges held in memory (e.g., the segments of a
+// memory-mapped file). Ranges aren't copied and must outlive the code source.
+class MemoryCodeSource : public CodeSource {
+ public:
+  // Note: Ranges must not overlap
+  void AddRange(uint64_t address, const uint8_t* data, size_t size);
+
+  size_t Read(uint64_t address, void* dest, size_t size) const override;
+
+ private:
+  struct Range {
+    uint64_t address;
+    const uint8_t* data;
+    size_t size;
+  };
+
+  // Sorted by address
+  std::vector<Range> ranges_{};
+};
+
+}  // namespace triton_bn
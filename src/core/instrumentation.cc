@@ -0,0 +1,91 @@
+#include "instrumentation.h"
+
+#include <iterator>
+#include <sstream>
+
+namespace triton_bn {
+
+// Note: Must be kept in sync with the `Stage` and `Counter` enums
+static const char* const kStageNames[] = {
+    "cfg_recovery",          "extraction",
+    "merge",                 "liveness",
+    "triton_simplification", "quick_simplification",
+    "nop_like_removal",      "disassembly",
+    "flow_graph_generation", "patching",
+};
+static const char* const kCounterNames[] = {
+    "simplified_basic_blocks",  "cached_basic_blocks",
+    "over_budget_basic_blocks", "extra_simplification_rounds",
+    "instructions_in",          "instructions_out",
+    "bytes_read",               "triton_contexts",
+    "instructions_disassembled_for_display",
+};
+static_assert(std::size(kStageNames) == static_cast<size_t>(Stage::kCount));
+static_assert(std::size(kCounterNames) ==
+              static_cast<size_t>(Counter::kCount));
+
+Instrumentation& Instrumentation::Instance() {
+  static Instrumentation instance{};
+  return instance;
+}
+
+void Instrumentation::Reset() {
+  for (size_t i = 0; i < kStageCount; i++) {
+    stage_times_ns_[i] = 0;
+    stage_call_counts_[i] = 0;
+  }
+  for (auto& counter : counters_) {
+    counter = 0;
+  }
+}
+
+void Instrumentation::AddStageTime(Stage stage, uint64_t duration_ns) {
+  const auto i = static_cast<size_t>(stage);
+  stage_times_ns_[i].fetch_add(duration_ns, std::memory_order_relaxed);
+  stage_call_counts_[i].fetch_add(1, std::memory_order_relaxed);
+}
+
+void Instrumentation::AddToCounter(Counter counter, uint64_t value) {
+  counters_[static_cast<size_t>(counter)].fetch_add(value,
+                                                    std::memory_order_relaxed);
+}
+
+std::string Instrumentation::GenerateSummary() const {
+  std::ostringstream summary{};
+  summary.setf(std::ios::fixed);
+  summary.precision(3);
+
+  summary << "Instrumentation summary:";
+  for (size_t i = 0; i < kStageCount; i++) {
+    const double stage_time_ms =
+        static_cast<double>(stage_times_ns_[i].load()) / 1e6;
+    summary << "\n  " << kStageNames[i] << ": " << stage_time_ms << " ms ("
+            << stage_call_counts_[i].load() << " call(s))";
+  }
+  for (size_t i = 0; i < kCounterCount; i++) {
+    summary << "\n  " << kCounterNames[i] << ": " << counters_[i].load();
+  }
+
+  return summary.str();
+}
+
+std::string Instrumentation::GenerateJson() const {
+  std::ostringstream json{};
+
+  json << "{\"stages\": {";
+  for (size_t i = 0; i < kStageCount; i++) {
+    json << (i == 0 ? "" : ", ") << "\"" << kStageNames[i]
+         << "\": {\"time_ns\": " << stage_times_ns_[i].load()
+         << ", \"calls\": " << stage_call_counts_[i].load() << "}";
+  }
+  json << "}, \"counters\": {";
+  for (size_t i = 0; i < kCounterCount; i++) {
+    json << (i == 0 ? "" : ", ") << "\"" << kCounterNames[i]
+         << "\": " << counters_[i].load();
+  }
+  json << "}}";
+
+  return json.str();
+}
+
+}  // namespace triton_bn
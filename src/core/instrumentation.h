@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace triton_bn {
+
+// Stages of the simplification pipeline that are timed
+enum class Stage : size_t {
+  kCfgRecovery,
+  kExtraction,
+  kMerge,
+  kLiveness,
+  kTritonSimplification,
+  kQuickSimplification,
+  kNopLikeRemoval,
+  kDisassembly,
+  kFlowGraphGeneration,
+  kPatching,
+  kCount,
+};
+
+enum class Counter : size_t {
+  kSimplifiedBasicBlocks,
+  kCachedBasicBlocks,
+  kOverBudgetBasicBlocks,
+  kExtraSimplificationRounds,
+  kInstructionsIn,
+  kInstructionsOut,
+  kBytesRead,
+  kTritonContexts,
+  kInstructionsDisassembledForDisplay,
+  kCount,
+};
+
+// Thread-safe collection of per-stage timings and counters. Events are
+// recorded into the collection bound to the current thread with
+// `ScopedInstrumentation`, or into the process-wide one if there's none, so
+// that commands running concurrently are accounted separately.
+// Instrumentation is disabled by default, in which case recording an event
+// only costs a relaxed atomic load.
+class Instrumentation {
+ public:
+  Instrumentation() = default;
+  Instrumentation(const Instrumentation&) = delete;
+  Instrumentation& operator=(const Instrumentation&) = delete;
+
+  static Instrumentation& Instance();
+  // Collection bound to the calling thread, `Instance()` if there's none
+  static Instrumentation& Current() {
+    return current_ != nullptr ? *current_ : Instance();
+  }
+
+  bool IsEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+  void SetEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+  // Note: Doesn't change whether instrumentation is enabled or not
+  void Reset();
+
+  void AddStageTime(Stage stage, uint64_t duration_ns);
+  void AddToCounter(Counter counter, uint64_t value);
+
+  // Human-readable, multi-line summary
+  std::string GenerateSummary() const;
+  // Structured record of the timings and counters
+  std::string GenerateJson() const;
+
+ private:
+  static constexpr size_t kStageCount = static_cast<size_t>(Stage::kCount);
+  static constexpr size_t kCounterCount = static_cast<size_t>(Counter::kCount);
+
+  friend class ScopedInstrumentation;
+  static inline thread_local Instrumentation* current_ = nullptr;
+
+  std::atomic<bool> enabled_{false};
+  std::array<std::atomic<uint64_t>, kStageCount> stage_times_ns_{};
+  std::array<std::atomic<uint64_t>, kStageCount> stage_call_counts_{};
+  std::array<std::atomic<uint64_t>, kCounterCount> counters_{};
+};
+
+// Record events of the calling thread into `instrumentation`, until the end
+// of the scope.
+// Note: Threads don't inherit the binding, threads spawned to do part of the
+// work must bind the `Instrumentation::Current()` of their parent
+class ScopedInstrumentation {
+ public:
+  explicit ScopedInstrumentation(Instrumentation& instrumentation)
+      : previous_(Instrumentation::current_) {
+    Instrumentation::current_ = &instrumentation;
+  }
+  ~ScopedInstrumentation() { Instrumentation::current_ = previous_; }
+
+  ScopedInstrumentation(const ScopedInstrumentation&) = delete;
+  ScopedInstrumentation& operator=(const ScopedInstrumentation&) = delete;
+
+ private:
+  Instrumentation* previous_;
+};
+
+// Measure the time spent in a given stage, until the end of the scope
+class ScopedStageTimer {
+ public:
+  explicit ScopedStageTimer(Stage stage)
+      : instrumentation_(Instrumentation::Current()),
+        stage_(stage),
+        enabled_(instrumentation_.IsEnabled()) {
+    if (enabled_) {
+      start_time_ = std::chrono::steady_clock::now();
+    }
+  }
+  ~ScopedStageTimer() {
+    if (enabled_) {
+      const auto duration = std::chrono::steady_clock::now() - start_time_;
+      instrumentation_.AddStageTime(
+          stage_,
+          std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+              .count());
+    }
+  }
+
+  ScopedStageTimer(const ScopedStageTimer&) = delete;
+  ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+ private:
+  Instrumentation& instrumentation_;
+  Stage stage_;
+  bool enabled_;
+  std::chrono::steady_clock::time_point start_time_{};
+};
+
+inline void CountEvent(Counter counter, uint64_t value = 1) {
+  Instrumentation& instrumentation = Instrumentation::Current();
+  if (instrumentation.IsEnabled()) {
+    instrumentation.AddToCounter(counter, value);
+  }
+}
+
+}  // namespace triton_bn
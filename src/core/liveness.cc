@@ -0,0 +1,309 @@
+#include "liveness.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "arch_traits.h"
+#include "call_summary.h"
+#include "instrumentation.h"
+#include "log.h"
+#include "meta_basic_block.h"
+
+namespace triton_bn {
+
+namespace {
+
+// Registers a basic block reads before writing them (`uses`) and registers it
+// overwrites entirely (`defs`)
+struct RegisterEffects {
+  RegisterSet uses{};
+  RegisterSet defs{};
+};
+
+using ComputeRegisterEffectsFn = RegisterEffects (*)(
+    triton::Context& tmp_ctx, const RegisterSet& all_registers,
+    const CallSummary* call_summary, MetaBasicBlock& meta_bb);
+
+}  // namespace
+
+template <typename Traits>
+static RegisterEffects ComputeRegisterEffects(
+    triton::Context& tmp_ctx, const RegisterSet& all_registers,
+    const CallSummary* call_summary, MetaBasicBlock& meta_bb);
+static bool IsFullRegisterWrite(triton::arch::architecture_e arch,
+                                const triton::arch::Register& reg,
+                                const triton::arch::Register& parent_reg);
+
+void ComputeLiveOutRegisters(const triton::Context& triton,
+                             const ControlFlowGraph& cfg,
+                             std::vector<MetaBasicBlock>& basic_blocks,
+                             const CallSummary* call_summary,
+                             ProgressMonitor* monitor) {
+  LivenessAnalysis analysis(triton, cfg, call_summary);
+  if (!analysis.Analyze(basic_blocks, monitor)) {
+    return;
+  }
+
+  const size_t analyzed_count =
+      std::count_if(std::cbegin(basic_blocks), std::cend(basic_blocks),
+                    [](const MetaBasicBlock& meta_bb) {
+                      return meta_bb.live_out().has_value();
+                    });
+  LogMessage(LogLevel::kDebug,
+             "Live-out registers computed for %zu out of %zu basic block(s)",
+             analyzed_count, basic_blocks.size());
+}
+
+LivenessAnalysis::LivenessAnalysis(const triton::Context& triton,
+                                   const ControlFlowGraph& cfg,
+                                   const CallSummary* call_summary)
+    : cfg_(cfg),
+      call_summary_(call_summary),
+      tmp_ctx_(triton.getArchitecture()) {
+  CountEvent(Counter::kTritonContexts);
+  for (const auto* reg : tmp_ctx_.getParentRegisters()) {
+    all_registers_.Insert(reg->getId());
+  }
+  // Note: Memory accesses depend on these, so they're kept alive everywhere
+  pinned_registers_.Insert(tmp_ctx_.getProgramCounter().getId());
+  pinned_registers_.Insert(tmp_ctx_.getStackPointer().getId());
+}
+
+bool LivenessAnalysis::Analyze(std::vector<MetaBasicBlock>& basic_blocks,
+                               ProgressMonitor* monitor) {
+  ScopedStageTimer timer(Stage::kLiveness);
+  const size_t bb_count = basic_blocks.size();
+  if (bb_count == 0) {
+    return true;
+  }
+
+  // Note: The pieces of a basic block (or chain of merged basic blocks) are
+  // contiguous and share the same CFG index. Pieces other than the last one
+  // end with a call.
+  // Note: Indexed with a map, `basic_blocks` can be a small part of the
+  // function
+  std::unordered_map<uint32_t, uint32_t> head_pieces{};
+  for (size_t i = bb_count; i-- > 0;) {
+    const uint32_t cfg_index = basic_blocks[i].cfg_index();
+    if (cfg_index >= cfg_.block_count()) {
+      LogMessage(LogLevel::kError, "Invalid basic block index %u", cfg_index);
+      return false;
+    }
+    head_pieces[cfg_index] = static_cast<uint32_t>(i);
+  }
+  auto is_last_piece = [&](size_t i) {
+    return i + 1 == bb_count ||
+           basic_blocks[i + 1].cfg_index() != basic_blocks[i].cfg_index();
+  };
+  // Piece the edge at `edge_index` leads to, `kInvalidBlockIndex` if it leads
+  // outside of `basic_blocks`
+  auto get_target_piece = [&](uint32_t edge_index) {
+    const auto it = head_pieces.find(cfg_.edge_targets[edge_index]);
+    return it != std::cend(head_pieces) ? it->second : kInvalidBlockIndex;
+  };
+
+  // Pieces whose successors are unknown, everything is live at their exit
+  std::vector<uint8_t> is_exit(bb_count, 0);
+  // Registers live at the exit of each piece, starting with those of the
+  // successors analyzed before
+  std::vector<RegisterSet> live_outs(bb_count);
+  // Predecessors of each piece, indexed by `pred_offsets`
+  std::vector<uint32_t> pred_offsets(bb_count + 1, 0);
+  std::vector<uint32_t> pred_pieces{};
+  for (size_t i = 0; i < bb_count; i++) {
+    const uint32_t last_cfg_index = basic_blocks[i].last_cfg_index();
+    if (!is_last_piece(i) || last_cfg_index >= cfg_.block_count() ||
+        cfg_.edges_begin(last_cfg_index) == cfg_.edges_end(last_cfg_index)) {
+      is_exit[i] = 1;
+      continue;
+    }
+    for (uint32_t edge_index = cfg_.edges_begin(last_cfg_index);
+         edge_index < cfg_.edges_end(last_cfg_index); edge_index++) {
+      const uint32_t target = cfg_.edge_targets[edge_index];
+      if (target == kInvalidBlockIndex ||
+          (head_pieces.count(target) == 0 && live_ins_.count(target) == 0)) {
+        is_exit[i] = 1;
+        break;
+      }
+    }
+    if (is_exit[i]) {
+      live_outs[i] = all_registers_;
+      continue;
+    }
+    for (uint32_t edge_index = cfg_.edges_begin(last_cfg_index);
+         edge_index < cfg_.edges_end(last_cfg_index); edge_index++) {
+      const uint32_t succ = get_target_piece(edge_index);
+      if (succ != kInvalidBlockIndex) {
+        pred_offsets[succ + 1]++;
+      } else {
+        live_outs[i].Union(live_ins_.at(cfg_.edge_targets[edge_index]));
+      }
+    }
+  }
+  for (size_t i = 0; i < bb_count; i++) {
+    pred_offsets[i + 1] += pred_offsets[i];
+  }
+  pred_pieces.resize(pred_offsets[bb_count]);
+  // Successors in `basic_blocks` of each piece, indexed by `succ_offsets`
+  std::vector<uint32_t> succ_offsets(bb_count + 1, 0);
+  std::vector<uint32_t> succ_pieces{};
+  {
+    std::vector<uint32_t> pred_counts(bb_count, 0);
+    for (size_t i = 0; i < bb_count; i++) {
+      succ_offsets[i] = static_cast<uint32_t>(succ_pieces.size());
+      if (is_exit[i]) {
+        continue;
+      }
+      const uint32_t last_cfg_index = basic_blocks[i].last_cfg_index();
+      for (uint32_t edge_index = cfg_.edges_begin(last_cfg_index);
+           edge_index < cfg_.edges_end(last_cfg_index); edge_index++) {
+        const uint32_t succ = get_target_piece(edge_index);
+        if (succ == kInvalidBlockIndex) {
+          continue;
+        }
+        pred_pieces[pred_offsets[succ] + pred_counts[succ]++] =
+            static_cast<uint32_t>(i);
+        succ_pieces.push_back(succ);
+      }
+    }
+    succ_offsets[bb_count] = static_cast<uint32_t>(succ_pieces.size());
+  }
+
+  // Note: The architecture is dispatched on once, for the whole group
+  const ComputeRegisterEffectsFn compute_register_effects =
+      DispatchArchitecture(tmp_ctx_.getArchitecture(), [](auto traits) {
+        return ComputeRegisterEffectsFn{
+            &ComputeRegisterEffects<decltype(traits)>};
+      });
+  std::vector<RegisterEffects> effects(bb_count);
+  for (size_t i = 0; i < bb_count; i++) {
+    if (monitor != nullptr) {
+      if (monitor->IsCancelled()) {
+        return false;
+      }
+      monitor->ReportProgress("Computing register liveness", i, bb_count);
+    }
+    effects[i] = compute_register_effects(tmp_ctx_, all_registers_,
+                                          call_summary_, basic_blocks[i]);
+  }
+
+  // Backward analysis, iterated until nothing changes. Sets only grow, which
+  // guarantees termination.
+  std::vector<RegisterSet> live_ins(bb_count);
+  std::vector<uint32_t> worklist{};
+  std::vector<uint8_t> in_worklist(bb_count, 1);
+  worklist.reserve(bb_count);
+  for (size_t i = 0; i < bb_count; i++) {
+    // Note: Popped from the back, so the last pieces are processed first
+    worklist.push_back(static_cast<uint32_t>(i));
+  }
+  while (!worklist.empty()) {
+    const uint32_t i = worklist.back();
+    worklist.pop_back();
+    in_worklist[i] = 0;
+
+    for (uint32_t succ_index = succ_offsets[i];
+         succ_index < succ_offsets[i + 1]; succ_index++) {
+      live_outs[i].Union(live_ins[succ_pieces[succ_index]]);
+    }
+
+    // live-in = uses + (live-out - defs)
+    RegisterSet live_in = live_outs[i];
+    live_in.Subtract(effects[i].defs);
+    live_in.Union(effects[i].uses);
+    if (!live_ins[i].Union(live_in)) {
+      continue;
+    }
+    for (uint32_t pred_index = pred_offsets[i];
+         pred_index < pred_offsets[i + 1]; pred_index++) {
+      const uint32_t pred = pred_pieces[pred_index];
+      if (!in_worklist[pred]) {
+        in_worklist[pred] = 1;
+        worklist.push_back(pred);
+      }
+    }
+  }
+
+  // Note: Kept for the groups analyzed next, whose basic blocks may branch
+  // to these
+  for (const auto& [cfg_index, head_piece] : head_pieces) {
+    live_ins_[cfg_index] = std::move(live_ins[head_piece]);
+  }
+  for (size_t i = 0; i < bb_count; i++) {
+    if (is_exit[i]) {
+      continue;
+    }
+    live_outs[i].Union(pinned_registers_);
+    basic_blocks[i].set_live_out(std::move(live_outs[i]));
+  }
+  return true;
+}
+
+// Execute the basic block's instructions to find out which registers they
+// access.
+// Note: Triton only reports the registers an instruction accesses once it's
+// been executed. Instructions it can't execute are assumed to read every
+// register.
+template <typename Traits>
+static RegisterEffects ComputeRegisterEffects(
+    triton::Context& tmp_ctx, const RegisterSet& all_registers,
+    const CallSummary* call_summary, MetaBasicBlock& meta_bb) {
+  RegisterEffects effects{};
+  for (const auto& instr : meta_bb.triton_bb().getInstructions()) {
+    triton::arch::Instruction executed_instr = instr;
+    bool executed = false;
+    try {
+      executed = tmp_ctx.processing(executed_instr) == triton::arch::NO_FAULT;
+    } catch (triton::exceptions::Exception& ex) {
+      executed = false;
+    }
+    if (!executed) {
+      effects.uses.Union(all_registers);
+      break;
+    }
+
+    for (const auto& [reg, node] : executed_instr.getReadRegisters()) {
+      const auto parent_reg_id = tmp_ctx.getParentRegister(reg).getId();
+      if (!effects.defs.Contains(parent_reg_id)) {
+        effects.uses.Insert(parent_reg_id);
+      }
+    }
+    // Note: Partially written registers keep the rest of their previous
+    // value, they aren't defined by the write
+    for (const auto& [reg, node] : executed_instr.getWrittenRegisters()) {
+      const auto& parent_reg = tmp_ctx.getParentRegister(reg);
+      if (IsFullRegisterWrite(Traits::kArchitecture, reg, parent_reg)) {
+        effects.defs.Insert(parent_reg.getId());
+      }
+    }
+
+    // The callee reads its arguments and overwrites clobbered registers
+    if (call_summary != nullptr && Traits::IsCall(instr)) {
+      RegisterSet arguments = call_summary->argument_registers;
+      arguments.Subtract(effects.defs);
+      effects.uses.Union(arguments);
+      effects.defs.Union(call_summary->clobbered_registers);
+    }
+  }
+
+  // Note: Symbolic expressions aren't needed across basic blocks, this
+  // releases them
+  tmp_ctx.concretizeAllRegister();
+  tmp_ctx.concretizeAllMemory();
+  return effects;
+}
+
+// Note: 32-bit writes to 64-bit general-purpose registers zero the upper half
+// on x86-64 and AArch64
+static bool IsFullRegisterWrite(triton::arch::architecture_e arch,
+                                const triton::arch::Register& reg,
+                                const triton::arch::Register& parent_reg) {
+  if (reg.getBitSize() == parent_reg.getBitSize()) {
+    return true;
+  }
+  return (arch == triton::arch::ARCH_X86_64 ||
+          arch == triton::arch::ARCH_AARCH64) &&
+         reg.getBitSize() == 32 && parent_reg.getBitSize() == 64;
+}
+
+}  // namespace triton_bn
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <triton/archEnums.hpp>
+#include <triton/context.hpp>
+#include <unordered_map>
+#include <vector>
+
+#include "cfg.h"
+#include "progress.h"
+
+namespace triton_bn {
+
+struct CallSummary;
+struct MetaBasicBlock;
+
+// Set of registers (flags included), identified by their Triton ID.
+// Note: Storage grows with the highest ID inserted, so that small sets stay
+// small
+class RegisterSet {
+ public:
+  void Insert(triton::arch::register_e reg) {
+    const size_t word_index = reg / 64;
+    if (word_index >= words_.size()) {
+      words_.resize(word_index + 1, 0);
+    }
+    words_[word_index] |= uint64_t{1} << (reg % 64);
+  }
+  bool Contains(triton::arch::register_e reg) const {
+    const size_t word_index = reg / 64;
+    return word_index < words_.size() &&
+           (words_[word_index] & (uint64_t{1} << (reg % 64))) != 0;
+  }
+
+  // Add the registers of `other` to this set. Returns true if this set has
+  // changed.
+  bool Union(const RegisterSet& other) {
+    if (other.words_.size() > words_.size()) {
+      words_.resize(other.words_.size(), 0);
+    }
+    bool changed = false;
+    for (size_t i = 0; i < other.words_.size(); i++) {
+      const uint64_t word = words_[i] | other.words_[i];
+      changed |= word != words_[i];
+      words_[i] = word;
+    }
+    return changed;
+  }
+  // Remove the registers of `other` from this set
+  void Subtract(const RegisterSet& other) {
+    const size_t word_count = std::min(words_.size(), other.words_.size());
+    for (size_t i = 0; i < word_count; i++) {
+      words_[i] &= ~other.words_[i];
+    }
+  }
+
+  const std::vector<uint64_t>& words() const { return words_; }
+
+ private:
+  std::vector<uint64_t> words_{};
+};
+
+// Compute which registers are live at the exit of each of `basic_blocks`, with
+// a backward data flow analysis over `cfg`, and attach the result to them.
+// `basic_blocks` must have been extracted from `cfg` (and possibly merged).
+// Calls inside basic blocks are modeled after `call_summary`, which is required
+// if basic blocks haven't been split at calls.
+// Note: Exits of the function, calls ending basic blocks and untargeted edges
+// are conservatively considered to use every register, basic blocks ending
+// with them are left without live-out set. Memory isn't tracked, stores are
+// always live.
+// Nothing is attached if `monitor` is cancelled.
+void ComputeLiveOutRegisters(const triton::Context& triton,
+                             const ControlFlowGraph& cfg,
+                             std::vector<MetaBasicBlock>& basic_blocks,
+                             const CallSummary* call_summary = nullptr,
+                             ProgressMonitor* monitor = nullptr);
+
+// Cross-basic block liveness, computed one group of basic blocks at a time so
+// that results are available before the whole function has been extracted.
+// The successors of a group's basic blocks must either be part of it or of a
+// group analyzed before, which is the case when groups are the strongly
+// connected components of the CFG, successors first. Successors that haven't
+// been analyzed are conservatively considered to use every register.
+class LivenessAnalysis {
+ public:
+  LivenessAnalysis(const triton::Context& triton, const ControlFlowGraph& cfg,
+                   const CallSummary* call_summary = nullptr);
+
+  // Compute which registers are live at the exit of each of `basic_blocks`
+  // and attach the result to them, as `ComputeLiveOutRegisters` does.
+  // Returns false, without attaching anything, if `monitor` is cancelled or
+  // if `basic_blocks` don't belong to the CFG.
+  bool Analyze(std::vector<MetaBasicBlock>& basic_blocks,
+               ProgressMonitor* monitor = nullptr);
+
+ private:
+  const ControlFlowGraph& cfg_;
+  const CallSummary* call_summary_;
+  triton::Context tmp_ctx_;
+  RegisterSet all_registers_{};
+  RegisterSet pinned_registers_{};
+  // Registers live at the entry of the basic blocks analyzed so far, by CFG
+  // index
+  std::unordered_map<uint32_t, RegisterSet> live_ins_{};
+};
+
+}  // namespace triton_bn
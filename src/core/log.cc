@@ -0,0 +1,61 @@
+#include "log.h"
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <vector>
+
+namespace triton_bn {
+
+static void DefaultLogSink(LogLevel level, const char* message);
+
+static std::atomic<LogSink> g_log_sink{DefaultLogSink};
+static std::atomic<LogLevel> g_min_log_level{LogLevel::kWarning};
+
+void SetLogSink(LogSink sink, LogLevel min_level) {
+  g_log_sink = sink;
+  g_min_log_level = min_level;
+}
+
+void LogMessage(LogLevel level, const char* format, ...) {
+  if (level < g_min_log_level) {
+    return;
+  }
+
+  va_list args;
+  va_start(args, format);
+  va_list args_copy;
+  va_copy(args_copy, args);
+  const int message_size = std::vsnprintf(nullptr, 0, format, args_copy);
+  va_end(args_copy);
+  if (message_size < 0) {
+    va_end(args);
+    return;
+  }
+  std::vector<char> message(static_cast<size_t>(message_size) + 1);
+  std::vsnprintf(message.data(), message.size(), format, args);
+  va_end(args);
+
+  g_log_sink.load()(level, message.data());
+}
+
+static void DefaultLogSink(LogLevel level, const char* message) {
+  const char* level_name = "";
+  switch (level) {
+    case LogLevel::kDebug:
+      level_name = "debug";
+      break;
+    case LogLevel::kInfo:
+      level_name = "info";
+      break;
+    case LogLevel::kWarning:
+      level_name = "warning";
+      break;
+    case LogLevel::kError:
+      level_name = "error";
+      break;
+  }
+  std::fprintf(stderr, "%s: %s\n", level_name, message);
+}
+
+}  // namespace triton_bn
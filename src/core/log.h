@@ -0,0 +1,17 @@
+#pragma once
+
+namespace triton_bn {
+
+enum class LogLevel { kDebug, kInfo, kWarning, kError };
+
+// Function messages are forwarded to. By default, warnings and errors are
+// printed to the standard error output.
+using LogSink = void (*)(LogLevel level, const char* message);
+
+// Note: Messages below `min_level` are discarded before being formatted
+void SetLogSink(LogSink sink, LogLevel min_level = LogLevel::kInfo);
+
+// Log a printf-style formatted message
+void LogMessage(LogLevel level, const char* format, ...);
+
+}  // namespace triton_bn
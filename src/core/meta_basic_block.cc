@@ -0,0 +1,509 @@
+#include "meta_basic_block.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <thread>
+#include <triton/context.hpp>
+#include <unordered_map>
+
+#include "arch_traits.h"
+#include "basic_block_simplifier.h"
+#include "call_summary.h"
+#include "instrumentation.h"
+#include "log.h"
+#include "nop_verdict_cache.h"
+#include "simplification_cache.h"
+
+namespace triton_bn {
+
+template <typename Traits>
+static std::vector<MetaBasicBlock> ExtractMetaBasicBlocksFromBasicBlock(
+    const CodeSource& code, const ControlFlowGraph& cfg, uint32_t cfg_index,
+    triton::Context& triton, bool split_at_calls,
+    std::vector<uint8_t>& bb_data);
+template <typename Traits>
+static void MergeLinkedBasicBlocks(MetaBasicBlock& root_bb,
+                                   MetaBasicBlock& target_bb);
+static bool SimplifyUncachedMetaBasicBlock(
+    const triton::Context& triton, MetaBasicBlock& meta_bb,
+    const SimplificationOptions& options);
+
+// Transform a given basic block of `cfg` into one or several
+// `MetaBasicBlock`s that can be simplified with Triton
+std::vector<MetaBasicBlock> ExtractMetaBasicBlocksFromBasicBlock(
+    const CodeSource& code, const ControlFlowGraph& cfg, uint32_t cfg_index,
+    triton::Context& triton, bool split_at_calls) {
+  std::vector<uint8_t> bb_data{};
+  return DispatchArchitecture(triton.getArchitecture(), [&](auto traits) {
+    return ExtractMetaBasicBlocksFromBasicBlock<decltype(traits)>(
+        code, cfg, cfg_index, triton, split_at_calls, bb_data);
+  });
+}
+
+// Same as above but `bb_data` is used as a scratch buffer to read the basic
+// block's content, so that it can be reused across basic blocks.
+// Note: Specialized for each architecture, so that instructions are classified
+// without checking the architecture each time
+template <typename Traits>
+static std::vector<MetaBasicBlock> ExtractMetaBasicBlocksFromBasicBlock(
+    const CodeSource& code, const ControlFlowGraph& cfg, uint32_t cfg_index,
+    triton::Context& triton, bool split_at_calls,
+    std::vector<uint8_t>& bb_data) {
+  ScopedStageTimer timer(Stage::kExtraction);
+  // TODO: Merge fallthrough automatically?
+  std::vector<MetaBasicBlock> result{};
+  triton::arch::BasicBlock triton_bb{};
+
+  // Read the whole basic block at once
+  const uint64_t bb_start = cfg.block_starts[cfg_index];
+  bb_data.resize(cfg.block_ends[cfg_index] - bb_start);
+  const size_t bb_size = code.Read(bb_start, bb_data.data(), bb_data.size());
+  CountEvent(Counter::kBytesRead, bb_size);
+
+  // Walk through the instructions
+  size_t cur_instr_offset = 0;
+  while (cur_instr_offset < bb_size) {
+    const uint64_t cur_instr_addr = bb_start + cur_instr_offset;
+    const uint8_t* cur_instr_data = &bb_data[cur_instr_offset];
+    const auto cur_max_instr_len = static_cast<uint32_t>(
+        std::min(kMaxInstructionSize, bb_size - cur_instr_offset));
+
+    // Add disassembled instruction to the basic block
+    // Note: Triton sets the instruction's actual size when disassembling it
+    triton::arch::Instruction new_instr(cur_instr_addr, cur_instr_data,
+                                        cur_max_instr_len);
+    try {
+      triton.disassembly(new_instr);
+    } catch (triton::exceptions::Disassembly& ex) {
+      LogMessage(LogLevel::kError,
+                 "Failed to disassemble instruction at address 0x%p",
+                 (void*)cur_instr_addr);
+      return {};
+    }
+    if (new_instr.getSize() == 0) {
+      LogMessage(LogLevel::kWarning,
+                 "Failed to decode instruction at address 0x%p",
+                 (void*)cur_instr_addr);
+      break;
+    }
+    cur_instr_offset += new_instr.getSize();
+    triton_bb.add(new_instr);
+    LogMessage(LogLevel::kDebug, "0x%p - %u", (void*)cur_instr_addr,
+               new_instr.getSize());
+
+    // Split basic blocks on `call` instructions to make them simplifiable
+    if (split_at_calls && Traits::IsCall(new_instr)) {
+      LogMessage(LogLevel::kDebug, "call detected at 0x%p",
+                 (void*)cur_instr_addr);
+      // Add basic block to the result
+      result.emplace_back(MetaBasicBlock(std::move(triton_bb), cfg, cfg_index));
+      triton_bb = {};
+    }
+  }
+  // Add basic block to the result
+  result.emplace_back(MetaBasicBlock(std::move(triton_bb), cfg, cfg_index));
+
+  return result;
+}
+
+// Same as `ExtractMetaBasicBlocksFromBasicBlock`, except we extract
+// `MetaBasicBlock`s from all the basic blocks of `cfg`.
+// Returns an empty vector if `monitor` is cancelled.
+std::vector<MetaBasicBlock> ExtractMetaBasicBlocksFromFunction(
+    const CodeSource& code, const ControlFlowGraph& cfg,
+    triton::Context& triton, ProgressMonitor* monitor, bool split_at_calls) {
+  std::vector<MetaBasicBlock> func_meta_basic_blocks{};
+
+  // Iterate through the basic blocks
+  std::vector<uint8_t> bb_data{};
+  const size_t bb_count = cfg.block_count();
+  const bool completed =
+      DispatchArchitecture(triton.getArchitecture(), [&](auto traits) {
+        for (size_t i = 0; i < bb_count; i++) {
+          if (monitor != nullptr) {
+            if (monitor->IsCancelled()) {
+              return false;
+            }
+            monitor->ReportProgress("Extracting basic blocks", i, bb_count);
+          }
+
+          auto meta_basic_blocks =
+              ExtractMetaBasicBlocksFromBasicBlock<decltype(traits)>(
+                  code, cfg, static_cast<uint32_t>(i), triton, split_at_calls,
+                  bb_data);
+          std::move(std::begin(meta_basic_blocks),
+                    std::end(meta_basic_blocks),
+                    back_inserter(func_meta_basic_blocks));
+        }
+        return true;
+      });
+  if (!completed) {
+    return {};
+  }
+
+  return func_meta_basic_blocks;
+}
+
+// Merge `MetaBasicBlock`s which are linked with single unconditional branches.
+// Chains of mergeable basic blocks are found with a single pass over the graph
+// and merged by moving their `MetaBasicBlock`s, which makes this
+// O(basic blocks + edges).
+// Returns an empty vector if `monitor` is cancelled.
+std::vector<MetaBasicBlock> MergeMetaBasicBlocks(
+    const ControlFlowGraph& cfg, std::vector<MetaBasicBlock> basic_blocks,
+    ProgressMonitor* monitor) {
+  ScopedStageTimer timer(Stage::kMerge);
+  const size_t bb_count = cfg.block_count();
+
+  // Note: `basic_blocks` may only hold some of the function's basic blocks, so
+  // they're indexed by extraction order (i.e., their position in `bb_order`)
+  // rather than by CFG index, which keeps the cost proportional to their count
+  std::unordered_map<uint32_t, uint32_t> local_indexes{};
+  // CFG indexes, in extraction order
+  std::vector<uint32_t> bb_order{};
+  // Basic blocks can be split into several `MetaBasicBlock`s at extraction,
+  // these pieces are linked in extraction order
+  std::vector<uint32_t> first_pieces{};
+  std::vector<uint32_t> last_pieces{};
+  std::vector<uint32_t> next_pieces(basic_blocks.size(), kInvalidBlockIndex);
+  for (size_t i = 0; i < basic_blocks.size(); i++) {
+    const uint32_t cfg_index = basic_blocks[i].cfg_index();
+    if (cfg_index >= bb_count) {
+      LogMessage(LogLevel::kError, "Invalid basic block index %u", cfg_index);
+      return {};
+    }
+
+    const auto piece_index = static_cast<uint32_t>(i);
+    const auto [it, inserted] = local_indexes.emplace(
+        cfg_index, static_cast<uint32_t>(bb_order.size()));
+    if (inserted) {
+      bb_order.push_back(cfg_index);
+      first_pieces.push_back(piece_index);
+      last_pieces.push_back(piece_index);
+    } else {
+      next_pieces[last_pieces[it->second]] = piece_index;
+      last_pieces[it->second] = piece_index;
+    }
+  }
+
+  // Find the successor each basic block can be merged with.
+  // Note: Only basic blocks whose single outgoing edge is unconditional can be
+  // merged with its target, and only if they're the target's only predecessor.
+  // So each basic block is part of at most one chain.
+  std::vector<uint32_t> merge_targets(bb_order.size(), kInvalidBlockIndex);
+  std::vector<uint8_t> is_merge_target(bb_order.size(), 0);
+  for (size_t i = 0; i < bb_order.size(); i++) {
+    const uint32_t cfg_index = bb_order[i];
+    const uint32_t edge_index = cfg.edges_begin(cfg_index);
+    if (cfg.edges_end(cfg_index) - edge_index != 1 ||
+        cfg.edge_types[edge_index] != BranchType::kUnconditional) {
+      continue;
+    }
+    const uint32_t target = cfg.edge_targets[edge_index];
+    if (target == kInvalidBlockIndex || target == cfg_index ||
+        cfg.incoming_edge_counts[target] != 1) {
+      continue;
+    }
+    const auto target_it = local_indexes.find(target);
+    if (target_it == std::cend(local_indexes)) {
+      continue;
+    }
+    merge_targets[i] = target_it->second;
+    is_merge_target[target_it->second] = 1;
+  }
+
+  // Note: All the basic blocks have been extracted for the same architecture
+  triton::arch::architecture_e architecture = triton::arch::ARCH_INVALID;
+  for (MetaBasicBlock& meta_bb : basic_blocks) {
+    const auto& instructions = meta_bb.triton_bb().getInstructions();
+    if (!instructions.empty()) {
+      architecture = instructions.front().getArchitecture();
+      break;
+    }
+  }
+  const auto merge_linked_basic_blocks =
+      DispatchArchitecture(architecture, [](auto traits) {
+        return &MergeLinkedBasicBlocks<decltype(traits)>;
+      });
+
+  std::vector<MetaBasicBlock> merged_meta_basic_blocks{};
+  merged_meta_basic_blocks.reserve(basic_blocks.size());
+  std::vector<uint8_t> merged(bb_order.size(), 0);
+  size_t merged_count = 0;
+  // Move the pieces of the chain starting at `root_index` (in extraction
+  // order) to the result
+  auto merge_chain = [&](uint32_t root_index) {
+    const size_t chain_start = merged_meta_basic_blocks.size();
+    uint32_t index = root_index;
+    for (;;) {
+      merged[index] = 1;
+      merged_count++;
+      for (uint32_t piece_index = first_pieces[index];
+           piece_index != kInvalidBlockIndex;
+           piece_index = next_pieces[piece_index]) {
+        if (index != root_index && piece_index == first_pieces[index]) {
+          // Continue the chain's last piece
+          merge_linked_basic_blocks(merged_meta_basic_blocks.back(),
+                                    basic_blocks[piece_index]);
+        } else {
+          merged_meta_basic_blocks.emplace_back(
+              std::move(basic_blocks[piece_index]));
+        }
+      }
+
+      const uint32_t target = merge_targets[index];
+      if (target == kInvalidBlockIndex || merged[target]) {
+        break;
+      }
+      index = target;
+    }
+
+    // Note: All the pieces are attached to the root basic block, so that
+    // they're regrouped after simplification
+    const MetaBasicBlock& root_bb = merged_meta_basic_blocks[chain_start];
+    const uint64_t root_start = root_bb.GetStart();
+    for (size_t i = chain_start + 1; i < merged_meta_basic_blocks.size();
+         i++) {
+      merged_meta_basic_blocks[i].JoinChain(root_start, bb_order[root_index],
+                                            bb_order[index]);
+    }
+    merged_meta_basic_blocks[chain_start].set_last_cfg_index(bb_order[index]);
+  };
+
+  // Chains are started from basic blocks that aren't merged into another one.
+  // Whatever remains afterwards belongs to cycles of mergeable basic blocks,
+  // which are broken at the first basic block found.
+  for (const bool cycles : {false, true}) {
+    for (size_t i = 0; i < bb_order.size(); i++) {
+      if (merged[i] || (!cycles && is_merge_target[i])) {
+        continue;
+      }
+      if (monitor != nullptr) {
+        if (monitor->IsCancelled()) {
+          return {};
+        }
+        monitor->ReportProgress("Merging basic blocks", merged_count,
+                                bb_order.size());
+      }
+      merge_chain(static_cast<uint32_t>(i));
+    }
+  }
+
+  return merged_meta_basic_blocks;
+}
+
+// Append the instructions of `target_bb` to `root_bb`, which is linked to it
+// with an unconditional edge
+template <typename Traits>
+static void MergeLinkedBasicBlocks(MetaBasicBlock& root_bb,
+                                   MetaBasicBlock& target_bb) {
+  triton::arch::BasicBlock& cur_triton_bb = root_bb.triton_bb();
+  triton::arch::BasicBlock& target_triton_bb = target_bb.triton_bb();
+
+  // Merge Triton's basic block
+  const uint64_t instruction_count = cur_triton_bb.getSize();
+  if (instruction_count > 0) {
+    const uint64_t last_instr_index = instruction_count - 1;
+    const triton::arch::Instruction& last_instr =
+        cur_triton_bb.getInstructions()[last_instr_index];
+    // Remove last instruction if it's a `jmp`
+    if (Traits::IsJump(last_instr)) {
+      LogMessage(LogLevel::kDebug, "jump detected at 0x%p",
+                 (void*)last_instr.getAddress());
+      cur_triton_bb.remove(static_cast<triton::uint32>(last_instr_index));
+    }
+  }
+  // Merge Triton instructions into the current basic block
+  for (triton::arch::Instruction& instr : target_triton_bb.getInstructions()) {
+    cur_triton_bb.add(instr);
+  }
+}
+
+// Simplify a single `MetaBasicBlock` in place, using the given Triton context.
+// The result of a previous simplification is reused if `options.cache` has
+// it.
+bool SimplifyMetaBasicBlock(const triton::Context& triton,
+                            MetaBasicBlock& meta_bb,
+                            const SimplificationOptions& options) {
+  // Reuse the previous result if the basic block hasn't changed since
+  SimplificationCache::Key cache_key{};
+  if (options.cache != nullptr) {
+    cache_key = SimplificationCache::MakeKey(
+        meta_bb, options.padding, options.max_rounds,
+        options.call_summary.has_value() ? &*options.call_summary : nullptr);
+    triton::arch::BasicBlock cached_triton_bb{};
+    if (options.cache->Lookup(cache_key, cached_triton_bb)) {
+      meta_bb.set_triton_bb(std::move(cached_triton_bb));
+      CountEvent(Counter::kCachedBasicBlocks);
+      return true;
+    }
+  }
+
+  if (!SimplifyUncachedMetaBasicBlock(triton, meta_bb, options)) {
+    return false;
+  }
+  if (options.cache != nullptr && !options.quick && !meta_bb.over_budget()) {
+    options.cache->Store(cache_key, meta_bb.triton_bb());
+  }
+  return true;
+}
+
+// Failures are reported for each basic block, so that the problematic ones can
+// be identified.
+static bool SimplifyUncachedMetaBasicBlock(
+    const triton::Context& triton, MetaBasicBlock& meta_bb,
+    const SimplificationOptions& options) {
+  // Simplify basic block and disassemble the result
+  try {
+    const auto& live_out = meta_bb.live_out();
+    const auto& call_summary = options.call_summary;
+    if (options.quick) {
+      meta_bb.set_triton_bb(QuickSimplifyTritonBasicBlock(
+          triton, meta_bb.triton_bb(), meta_bb.GetStart(), options.padding));
+      return true;
+    }
+    std::optional<BudgetTracker> budget{};
+    if (options.budget.IsLimited() || options.memory_governor != nullptr) {
+      budget.emplace(options.budget, options.memory_governor);
+    }
+    meta_bb.set_triton_bb(SimplifyTritonBasicBlock(
+        triton, meta_bb.triton_bb(), meta_bb.GetStart(), options.padding,
+        live_out.has_value() ? &*live_out : nullptr,
+        call_summary.has_value() ? &*call_summary : nullptr,
+        budget.has_value() ? &*budget : nullptr, options.max_rounds));
+    if (budget.has_value() && budget->IsExceeded()) {
+      meta_bb.set_over_budget(true);
+      LogMessage(LogLevel::kWarning,
+                 "Basic block at 0x%p ran out of simplification budget",
+                 (void*)meta_bb.GetStart());
+    }
+    return true;
+  } catch (triton::exceptions::Exception& ex) {
+    LogMessage(LogLevel::kError, "Failed to simplify basic block at 0x%p: %s",
+               (void*)meta_bb.GetStart(), ex.what());
+    return false;
+  }
+}
+
+// Simplify the given `MetaBasicBlock`s with Triton's dead store elimination
+// pass, restricted to their live-out registers when these are known. Basic
+// blocks are independent from one another, so they're dispatched to
+// `options.worker_count` threads, each owning its own Triton context.
+// Returns an empty vector if `options.monitor` is cancelled.
+std::vector<MetaBasicBlock> SimplifyMetaBasicBlocks(
+    const triton::Context& triton, std::vector<MetaBasicBlock> basic_blocks,
+    const SimplificationOptions& options) {
+  // Simplify basic blocks
+  std::vector<MetaBasicBlock> simplified_basic_blocks(basic_blocks.size());
+  {
+    const auto triton_arch = triton.getArchitecture();
+    // Note: `std::vector<bool>` can't be written to concurrently
+    std::vector<uint8_t> failed_blocks(basic_blocks.size(), 0);
+    std::atomic<size_t> next_block_index{0};
+    std::atomic<size_t> completed_block_count{0};
+    ProgressMonitor* monitor = options.monitor;
+
+    // Note: Workers record their events with the caller's
+    Instrumentation& instrumentation = Instrumentation::Current();
+    auto simplification_worker = [&]() {
+      ScopedInstrumentation scoped_instrumentation(instrumentation);
+      // Intialize Triton's context
+      triton::Context triton{};
+      triton.setArchitecture(triton_arch);
+      CountEvent(Counter::kTritonContexts);
+
+      // Dynamically pick the next basic block to process, this keeps workers
+      // busy even when basic block sizes vary a lot
+      for (;;) {
+        if (monitor != nullptr) {
+          if (monitor->IsCancelled()) {
+            break;
+          }
+          monitor->ReportProgress("Simplifying basic blocks",
+                                  completed_block_count, basic_blocks.size());
+        }
+
+        const size_t i = next_block_index.fetch_add(1);
+        if (i >= basic_blocks.size()) {
+          break;
+        }
+
+        MetaBasicBlock& meta_bb = basic_blocks[i];
+        if (!SimplifyMetaBasicBlock(triton, meta_bb, options)) {
+          failed_blocks[i] = 1;
+          completed_block_count++;
+          continue;
+        }
+        simplified_basic_blocks[i] = std::move(meta_bb);
+        completed_block_count++;
+      }
+    };
+
+    size_t worker_count = options.worker_count;
+    if (worker_count == 0) {
+      worker_count = std::max(1U, std::thread::hardware_concurrency());
+    }
+    worker_count = std::min(worker_count, basic_blocks.size());
+
+    // The calling thread acts as one of the workers
+    std::vector<std::thread> workers{};
+    for (size_t i = 1; i < worker_count; i++) {
+      workers.emplace_back(simplification_worker);
+    }
+    simplification_worker();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+
+    if (monitor != nullptr) {
+      if (monitor->IsCancelled()) {
+        return {};
+      }
+      monitor->ReportProgress("Simplifying basic blocks",
+                              basic_blocks.size(), basic_blocks.size());
+    }
+
+    const size_t failed_block_count =
+        std::count(std::cbegin(failed_blocks), std::cend(failed_blocks), 1);
+    if (failed_block_count > 0) {
+      LogMessage(LogLevel::kError,
+                 "Failed to simplify function (%zu basic block(s) failed)",
+                 failed_block_count);
+      return {};
+    }
+
+    const NopVerdictCache& verdict_cache = NopVerdictCache::Instance();
+    LogMessage(LogLevel::kDebug,
+               "NOP-like verdict cache: %llu hit(s), %llu miss(es)",
+               (unsigned long long)verdict_cache.hit_count(),
+               (unsigned long long)verdict_cache.miss_count());
+  }
+
+  // Regroup split simplified basic blocks
+  std::unordered_map<uint64_t, MetaBasicBlock*> final_bbs_addr_map{};
+  std::vector<MetaBasicBlock> final_basic_blocks{};
+  final_basic_blocks.reserve(simplified_basic_blocks.size());
+  for (MetaBasicBlock meta_bb : simplified_basic_blocks) {
+    const uint64_t bb_addr = meta_bb.GetStart();
+    if (final_bbs_addr_map[bb_addr] == nullptr) {
+      // Add to the list
+      final_basic_blocks.emplace_back(std::move(meta_bb));
+      final_bbs_addr_map[bb_addr] =
+          &final_basic_blocks[final_basic_blocks.size() - 1];
+    } else {
+      // Regroup with the previous basic block
+      MetaBasicBlock* previous_bb = final_bbs_addr_map[bb_addr];
+      for (auto& instr : meta_bb.triton_bb().getInstructions()) {
+        previous_bb->triton_bb().add(instr);
+      }
+      if (meta_bb.over_budget()) {
+        previous_bb->set_over_budget(true);
+      }
+    }
+  }
+
+  return final_basic_blocks;
+}
+
+}  // namespace triton_bn
\ No newline at end of file
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <optional>
+#include <triton/basicBlock.hpp>
+#include <triton/context.hpp>
+#include <vector>
+
+#include "call_summary.h"
+#include "cfg.h"
+#include "code_source.h"
+#include "liveness.h"
+#include "progress.h"
+#include "simplification_budget.h"
+
+namespace triton_bn {
+
+// Note: Edges aren't copied, they're read from the `ControlFlowGraph` the
+// basic block has been extracted from
+struct MetaBasicBlock {
+  MetaBasicBlock() = default;
+  explicit MetaBasicBlock(triton::arch::BasicBlock triton_bb,
+                          const ControlFlowGraph& cfg, uint32_t cfg_index)
+      : triton_bb_(std::move(triton_bb)),
+        function_start_(cfg.function_start),
+        cfg_index_(cfg_index),
+        last_cfg_index_(cfg_index) {
+    assert(cfg_index_ < cfg.block_count());
+    start_ = cfg.block_starts[cfg_index_];
+  }
+
+  triton::arch::BasicBlock& triton_bb() { return triton_bb_; }
+  const triton::arch::BasicBlock& triton_bb() const { return triton_bb_; }
+  void set_triton_bb(triton::arch::BasicBlock triton_bb) {
+    triton_bb_ = std::move(triton_bb);
+  }
+
+  // Index of the basic block this has been extracted from, in the
+  // `ControlFlowGraph` given at extraction
+  uint32_t cfg_index() const { return cfg_index_; }
+  // Index of the last basic block merged into this one, whose outgoing edges
+  // are this basic block's. Same as `cfg_index()` if nothing has been merged.
+  uint32_t last_cfg_index() const { return last_cfg_index_; }
+  void set_last_cfg_index(uint32_t last_cfg_index) {
+    last_cfg_index_ = last_cfg_index;
+  }
+  uint64_t function_start() const { return function_start_; }
+
+  // Registers live at the end of the basic block, see
+  // `ComputeLiveOutRegisters`. All registers are if this isn't set.
+  const std::optional<RegisterSet>& live_out() const { return live_out_; }
+  void set_live_out(RegisterSet live_out) { live_out_ = std::move(live_out); }
+
+  // Whether the simplification ran out of budget, in which case the basic
+  // block hasn't been fully simplified. See `SimplificationBudget`.
+  bool over_budget() const { return over_budget_; }
+  void set_over_budget(bool over_budget) { over_budget_ = over_budget; }
+
+  // Make this part of the basic block at `start` (i.e., `cfg_index`) after
+  // being merged into it
+  void JoinChain(uint64_t start, uint32_t cfg_index, uint32_t last_cfg_index) {
+    start_ = start;
+    cfg_index_ = cfg_index;
+    last_cfg_index_ = last_cfg_index;
+  }
+
+  uint64_t GetStart() const { return start_; }
+
+ private:
+  triton::arch::BasicBlock triton_bb_{};
+  uint64_t start_ = 0;
+  uint64_t function_start_ = 0;
+  uint32_t cfg_index_ = kInvalidBlockIndex;
+  uint32_t last_cfg_index_ = kInvalidBlockIndex;
+  std::optional<RegisterSet> live_out_{};
+  bool over_budget_ = false;
+};
+
+// Note: The bytes of the basic blocks are read from `code`, `cfg` only
+// describes their layout. Basic blocks are split after each call unless
+// `split_at_calls` is false, in which case they must be simplified with a
+// `CallSummary`.
+std::vector<MetaBasicBlock> ExtractMetaBasicBlocksFromBasicBlock(
+    const CodeSource& code, const ControlFlowGraph& cfg, uint32_t cfg_index,
+    triton::Context& triton, bool split_at_calls = true);
+
+std::vector<MetaBasicBlock> ExtractMetaBasicBlocksFromFunction(
+    const CodeSource& code, const ControlFlowGraph& cfg,
+    triton::Context& triton, ProgressMonitor* monitor = nullptr,
+    bool split_at_calls = true);
+
+std::vector<MetaBasicBlock> MergeMetaBasicBlocks(
+    const ControlFlowGraph& cfg, std::vector<MetaBasicBlock> basic_blocks,
+    ProgressMonitor* monitor = nullptr);
+
+class SimplificationCache;
+
+struct SimplificationOptions {
+  // Replace removed instructions with NOP instructions of the same size
+  bool padding = false;
+  // Number of threads used to simplify basic blocks, 0 means one per hardware
+  // thread
+  size_t worker_count = 1;
+  // Optional cache used to reuse the results of previous simplifications
+  SimplificationCache* cache = nullptr;
+  // Effects of the calls made by basic blocks, required if they haven't been
+  // split at calls
+  std::optional<CallSummary> call_summary{};
+  // Optional monitor notified of the progress, simplification stops early
+  // (and returns no basic blocks) when it's cancelled
+  ProgressMonitor* monitor = nullptr;
+  // Maximum number of basic blocks waiting between two stages of
+  // `RunSimplificationPipeline`
+  size_t queue_depth = 64;
+  // Use `QuickSimplifyTritonBasicBlock`, which is cheaper but simplifies less.
+  // Cached results are reused but quick results are never cached.
+  bool quick = false;
+  // Limits on the work spent on each basic block. Results of basic blocks that
+  // run over budget aren't cached.
+  SimplificationBudget budget{};
+  // Optional governor the symbolic state of basic blocks is accounted against,
+  // basic blocks that would push it past its ceiling run over budget
+  AstMemoryGovernor* memory_governor = nullptr;
+  // Maximum number of dead store elimination and NOP-like instruction removal
+  // rounds, basic blocks stop being processed once a round leaves them
+  // unchanged
+  size_t max_rounds = 1;
+};
+
+bool SimplifyMetaBasicBlock(const triton::Context& triton,
+                            MetaBasicBlock& meta_bb,
+                            const SimplificationOptions& options);
+
+std::vector<MetaBasicBlock> SimplifyMetaBasicBlocks(
+    const triton::Context& triton, std::vector<MetaBasicBlock> basic_blocks,
+    const SimplificationOptions& options = {});
+
+}  // namespace triton_bn
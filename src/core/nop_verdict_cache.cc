@@ -0,0 +1,105 @@
+#include "nop_verdict_cache.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include "arch_traits.h"
+
+namespace triton_bn {
+
+static bool IsPcRelativeInstruction(triton::arch::architecture_e architecture,
+                                    const triton::arch::Instruction& instr);
+
+NopVerdictCache& NopVerdictCache::Instance() {
+  static NopVerdictCache instance{};
+  return instance;
+}
+
+NopVerdictCache::Key NopVerdictCache::MakeKey(
+    triton::arch::architecture_e architecture,
+    const triton::arch::Instruction& instr) {
+  Key key{};
+  key.architecture = architecture;
+  key.pc_relative = IsPcRelativeInstruction(architecture, instr);
+  key.opcode_size = static_cast<uint8_t>(
+      std::min<size_t>(instr.getSize(), key.opcode.size()));
+  std::copy_n(instr.getOpcode(), key.opcode_size, std::begin(key.opcode));
+
+  return key;
+}
+
+std::optional<bool> NopVerdictCache::Lookup(const Key& key) {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  const auto it = verdicts_.find(key);
+  if (it == std::cend(verdicts_)) {
+    miss_count_++;
+    return std::nullopt;
+  }
+
+  hit_count_++;
+  return it->second;
+}
+
+void NopVerdictCache::Insert(const Key& key, bool is_nop_like) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  verdicts_.emplace(key, is_nop_like);
+}
+
+void NopVerdictCache::Clear() {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  verdicts_.clear();
+  hit_count_ = 0;
+  miss_count_ = 0;
+}
+
+// FNV-1a
+size_t NopVerdictCache::KeyHash::operator()(const Key& key) const {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  auto hash_byte = [&hash](uint8_t byte) {
+    hash ^= byte;
+    hash *= 0x100000001b3ULL;
+  };
+
+  hash_byte(static_cast<uint8_t>(key.architecture));
+  hash_byte(static_cast<uint8_t>(key.pc_relative));
+  hash_byte(key.opcode_size);
+  for (size_t i = 0; i < key.opcode_size; i++) {
+    hash_byte(key.opcode[i]);
+  }
+
+  return static_cast<size_t>(hash);
+}
+
+// Check if any of the instruction's operands refers to the program counter
+static bool IsPcRelativeInstruction(triton::arch::architecture_e architecture,
+                                    const triton::arch::Instruction& instr) {
+  const triton::arch::register_e pc_reg_id =
+      DispatchArchitecture(architecture, [](auto traits) {
+        return decltype(traits)::kProgramCounter;
+      });
+  if (pc_reg_id == triton::arch::ID_REG_INVALID) {
+    return false;
+  }
+
+  for (const auto& operand : instr.operands) {
+    switch (operand.getType()) {
+      case triton::arch::OP_REG:
+        if (operand.getConstRegister().getParent() == pc_reg_id) {
+          return true;
+        }
+        break;
+      case triton::arch::OP_MEM:
+        if (operand.getConstMemory().getConstBaseRegister().getParent() ==
+            pc_reg_id) {
+          return true;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  return false;
+}
+
+}  // namespace triton_bn
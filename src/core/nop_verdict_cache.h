@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <triton/instruction.hpp>
+#include <unordered_map>
+
+namespace triton_bn {
+
+// Thread-safe cache of the verdicts of the NOP-like instruction detection.
+// Obfuscators tend to reuse the same junk encodings over and over, so verdicts
+// are keyed by instruction bytes and computed only once per encoding.
+class NopVerdictCache {
+ public:
+  struct Key {
+    triton::arch::architecture_e architecture;
+    bool pc_relative;
+    uint8_t opcode_size;
+    std::array<uint8_t, 16> opcode;
+
+    bool operator==(const Key& other) const {
+      return architecture == other.architecture &&
+             pc_relative == other.pc_relative &&
+             opcode_size == other.opcode_size && opcode == other.opcode;
+    }
+  };
+
+  static NopVerdictCache& Instance();
+
+  // Build the key corresponding to a given (disassembled) instruction
+  static Key MakeKey(triton::arch::architecture_e architecture,
+                     const triton::arch::Instruction& instr);
+
+  // Return the cached verdict for the given key, if any
+  std::optional<bool> Lookup(const Key& key);
+  void Insert(const Key& key, bool is_nop_like);
+  void Clear();
+
+  uint64_t hit_count() const { return hit_count_; }
+  uint64_t miss_count() const { return miss_count_; }
+
+ private:
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
+  std::shared_mutex mutex_{};
+  std::unordered_map<Key, bool, KeyHash> verdicts_{};
+  std::atomic<uint64_t> hit_count_{0};
+  std::atomic<uint64_t> miss_count_{0};
+};
+
+}  // namespace triton_bn
@@ -0,0 +1,141 @@
+#include "patch_builder.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace triton_bn {
+
+// Changes separated by fewer unchanged bytes than this are written at once
+constexpr size_t kMaxUnchangedGapSize = 8;
+
+namespace {
+
+struct InstructionPatch {
+  uint64_t address;
+  size_t size;
+  const uint8_t* opcode;
+};
+
+// Contiguous range of patched bytes
+struct PatchRegion {
+  uint64_t start;
+  uint64_t end;
+  std::vector<uint8_t> original_data{};
+  std::vector<uint8_t> patched_data{};
+};
+
+}  // namespace
+
+static std::vector<PatchRegion> BuildPatchRegions(
+    const CodeSource& code, const std::vector<InstructionPatch>& patches);
+
+std::vector<Patch> BuildPatches(const CodeSource& code,
+                                std::vector<MetaBasicBlock>& basic_blocks,
+                                PatchStatistics& statistics) {
+  std::vector<Patch> result{};
+
+  // Note: Patches are kept in write order, so that later instructions
+  // overwrite earlier ones if they overlap
+  std::vector<InstructionPatch> patches{};
+  for (auto& basic_block : basic_blocks) {
+    for (auto& instruction : basic_block.triton_bb().getInstructions()) {
+      if (instruction.getSize() > 0) {
+        patches.push_back({instruction.getAddress(), instruction.getSize(),
+                           instruction.getOpcode()});
+      }
+    }
+  }
+  if (patches.empty()) {
+    return result;
+  }
+
+  std::vector<PatchRegion> regions = BuildPatchRegions(code, patches);
+
+  // Diff patched regions against the original content
+  for (const PatchRegion& region : regions) {
+    size_t i = 0;
+    while (i < region.patched_data.size()) {
+      if (region.patched_data[i] == region.original_data[i]) {
+        i++;
+        continue;
+      }
+
+      // Extend the change until a large enough unchanged gap is found
+      const size_t change_start = i;
+      size_t change_end = i + 1;
+      for (size_t j = change_end; j < region.patched_data.size(); j++) {
+        if (region.patched_data[j] != region.original_data[j]) {
+          statistics.changed_byte_count += 1;
+          change_end = j + 1;
+        } else if (j - change_end >= kMaxUnchangedGapSize) {
+          break;
+        }
+      }
+      statistics.changed_byte_count += 1;
+
+      Patch patch{};
+      patch.address = region.start + change_start;
+      patch.data.assign(std::begin(region.patched_data) + change_start,
+                        std::begin(region.patched_data) + change_end);
+      result.emplace_back(std::move(patch));
+      statistics.write_count += 1;
+      i = change_end;
+    }
+  }
+
+  return result;
+}
+
+// Group patches into contiguous regions, read the regions' original content
+// and apply the patches on top of it
+static std::vector<PatchRegion> BuildPatchRegions(
+    const CodeSource& code, const std::vector<InstructionPatch>& patches) {
+  std::vector<const InstructionPatch*> sorted_patches{};
+  sorted_patches.reserve(patches.size());
+  for (const auto& patch : patches) {
+    sorted_patches.push_back(&patch);
+  }
+  std::sort(std::begin(sorted_patches), std::end(sorted_patches),
+            [](const InstructionPatch* lhs, const InstructionPatch* rhs) {
+              return lhs->address < rhs->address;
+            });
+
+  // Merge overlapping and adjacent patches
+  std::vector<PatchRegion> regions{};
+  for (const InstructionPatch* patch : sorted_patches) {
+    const uint64_t patch_end = patch->address + patch->size;
+    if (!regions.empty() && patch->address <= regions.back().end) {
+      regions.back().end = std::max(regions.back().end, patch_end);
+    } else {
+      regions.push_back({patch->address, patch_end});
+    }
+  }
+
+  for (PatchRegion& region : regions) {
+    region.original_data.resize(region.end - region.start);
+    const size_t read_size = code.Read(region.start,
+                                       region.original_data.data(),
+                                       region.original_data.size());
+    // Note: Unreadable bytes are read as zeros
+    std::fill(std::begin(region.original_data) + read_size,
+              std::end(region.original_data), 0);
+    region.patched_data = region.original_data;
+  }
+
+  for (const InstructionPatch& patch : patches) {
+    // Find the region the patch belongs to
+    auto region_it = std::upper_bound(
+        std::begin(regions), std::end(regions), patch.address,
+        [](uint64_t address, const PatchRegion& region) {
+          return address < region.start;
+        });
+    --region_it;
+    std::copy_n(patch.opcode, patch.size,
+                std::begin(region_it->patched_data) +
+                    (patch.address - region_it->start));
+  }
+
+  return regions;
+}
+
+}  // namespace triton_bn
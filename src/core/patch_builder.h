@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "code_source.h"
+#include "meta_basic_block.h"
+
+namespace triton_bn {
+
+// Range of bytes to write
+struct Patch {
+  uint64_t address = 0;
+  std::vector<uint8_t> data{};
+};
+
+struct PatchStatistics {
+  size_t changed_byte_count = 0;
+  size_t write_count = 0;
+};
+
+// Compute the writes needed to lay the instructions of the given
+// `MetaBasicBlock`s over `code`. Only the bytes that differ from the current
+// content are written and nearby changes are coalesced into a single write.
+// Note: Patches are sorted by address and don't overlap.
+std::vector<Patch> BuildPatches(const CodeSource& code,
+                                std::vector<MetaBasicBlock>& basic_blocks,
+                                PatchStatistics& statistics);
+
+}  // namespace triton_bn
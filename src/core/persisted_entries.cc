@@ -0,0 +1,158 @@
+#include "persisted_entries.h"
+
+#include <iterator>
+
+namespace triton_bn {
+
+// Version of the persisted records' format, records with another version are
+// ignored
+constexpr uint8_t kPersistedFormatVersion = 1;
+// Ranges are contiguous instructions of a basic block, anything bigger comes
+// from a corrupted record
+constexpr uint64_t kMaxPersistedRangeSize = 16 * 1024 * 1024;
+
+static void WriteVarint(std::vector<uint8_t>& data, uint64_t value);
+static void WriteAddressDelta(std::vector<uint8_t>& data, uint64_t address,
+                              uint64_t& previous_address);
+static bool ReadVarint(const std::vector<uint8_t>& data, size_t& offset,
+                       uint64_t& value);
+static bool ReadAddressDelta(const std::vector<uint8_t>& data, size_t& offset,
+                             uint64_t& previous_address);
+
+// Records are made of LEB128 integers, addresses are stored relative to the
+// previous one (zigzag encoded) to keep them small:
+//   version, entry count, then for each entry:
+//     start, padding, fingerprint, content hash,
+//     range count, (start, size) of each range,
+//     instruction count, (size, bytes) of each instruction
+static void WriteVarint(std::vector<uint8_t>& data, uint64_t value) {
+  while (value >= 0x80) {
+    data.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  data.push_back(static_cast<uint8_t>(value));
+}
+
+static void WriteAddressDelta(std::vector<uint8_t>& data, uint64_t address,
+                              uint64_t& previous_address) {
+  const auto delta = static_cast<int64_t>(address - previous_address);
+  WriteVarint(data, (static_cast<uint64_t>(delta) << 1) ^
+                        static_cast<uint64_t>(delta >> 63));
+  previous_address = address;
+}
+
+static bool ReadVarint(const std::vector<uint8_t>& data, size_t& offset,
+                       uint64_t& value) {
+  value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (offset >= data.size()) {
+      return false;
+    }
+    const uint8_t byte = data[offset++];
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ReadAddressDelta(const std::vector<uint8_t>& data, size_t& offset,
+                             uint64_t& previous_address) {
+  uint64_t zigzag_delta = 0;
+  if (!ReadVarint(data, offset, zigzag_delta)) {
+    return false;
+  }
+  previous_address += (zigzag_delta >> 1) ^ (~(zigzag_delta & 1) + 1);
+  return true;
+}
+
+std::vector<uint8_t> SerializePersistedEntries(
+    const std::vector<PersistedEntry>& entries) {
+  std::vector<uint8_t> data{kPersistedFormatVersion};
+  WriteVarint(data, entries.size());
+  uint64_t previous_address = 0;
+  for (const auto& entry : entries) {
+    WriteAddressDelta(data, entry.start, previous_address);
+    data.push_back(entry.padding ? 1 : 0);
+    WriteVarint(data, entry.fingerprint);
+    WriteVarint(data, entry.content_hash);
+    WriteVarint(data, entry.ranges.size());
+    for (const auto& [range_start, range_end] : entry.ranges) {
+      WriteAddressDelta(data, range_start, previous_address);
+      WriteVarint(data, range_end - range_start);
+    }
+    WriteVarint(data, entry.opcodes.size());
+    for (const auto& opcode : entry.opcodes) {
+      WriteVarint(data, opcode.size());
+      data.insert(std::end(data), std::begin(opcode), std::end(opcode));
+    }
+  }
+
+  return data;
+}
+
+// Note: Counts are checked against the remaining size, so that corrupted
+// records can't trigger huge allocations
+bool DeserializePersistedEntries(const std::vector<uint8_t>& data,
+                                 std::vector<PersistedEntry>& entries) {
+  if (data.empty() || data[0] != kPersistedFormatVersion) {
+    return false;
+  }
+  size_t offset = 1;
+  auto read_count = [&](uint64_t& count) {
+    return ReadVarint(data, offset, count) && count <= data.size() - offset;
+  };
+
+  uint64_t entry_count = 0;
+  if (!read_count(entry_count)) {
+    return false;
+  }
+  uint64_t previous_address = 0;
+  for (uint64_t i = 0; i < entry_count; i++) {
+    PersistedEntry entry{};
+    uint64_t range_count = 0;
+    if (!ReadAddressDelta(data, offset, previous_address)) {
+      return false;
+    }
+    entry.start = previous_address;
+    if (offset >= data.size()) {
+      return false;
+    }
+    entry.padding = data[offset++] != 0;
+    if (!ReadVarint(data, offset, entry.fingerprint) ||
+        !ReadVarint(data, offset, entry.content_hash) ||
+        !read_count(range_count)) {
+      return false;
+    }
+    for (uint64_t j = 0; j < range_count; j++) {
+      uint64_t range_size = 0;
+      if (!ReadAddressDelta(data, offset, previous_address) ||
+          !ReadVarint(data, offset, range_size) ||
+          range_size > kMaxPersistedRangeSize) {
+        return false;
+      }
+      entry.ranges.emplace_back(previous_address,
+                                previous_address + range_size);
+    }
+
+    uint64_t instruction_count = 0;
+    if (!read_count(instruction_count)) {
+      return false;
+    }
+    for (uint64_t j = 0; j < instruction_count; j++) {
+      uint64_t opcode_size = 0;
+      if (!read_count(opcode_size)) {
+        return false;
+      }
+      const auto opcode_begin = std::begin(data) + offset;
+      entry.opcodes.emplace_back(opcode_begin, opcode_begin + opcode_size);
+      offset += opcode_size;
+    }
+    entries.emplace_back(std::move(entry));
+  }
+
+  return offset == data.size();
+}
+
+}  // namespace triton_bn
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "simplification_cache.h"
+
+namespace triton_bn {
+
+// Simplification result as stored in a database's metadata, see
+// `ViewSimplificationCache`
+struct PersistedEntry {
+  uint64_t start = 0;
+  bool padding = false;
+  uint64_t fingerprint = 0;
+  // Hash of the bytes located in `ranges`
+  uint64_t content_hash = 0;
+  std::vector<SimplificationCache::AddressRange> ranges{};
+  // Encoding of each simplified instruction, laid out from `start`
+  std::vector<std::vector<uint8_t>> opcodes{};
+};
+
+// Encode `entries` as a compact record
+std::vector<uint8_t> SerializePersistedEntries(
+    const std::vector<PersistedEntry>& entries);
+// Decode a record made by `SerializePersistedEntries` and append its entries
+// to `entries`. Returns false if the record is corrupted or has another
+// version, `entries` may then hold part of its content.
+bool DeserializePersistedEntries(const std::vector<uint8_t>& data,
+                                 std::vector<PersistedEntry>& entries);
+
+}  // namespace triton_bn
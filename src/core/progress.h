@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+
+namespace triton_bn {
+
+// Interface used by long-running operations to report their progress and to
+// check whether they've been cancelled by the user.
+// Note: Implementations must be thread-safe, operations may report progress
+// from several threads at once.
+class ProgressMonitor {
+ public:
+  virtual ~ProgressMonitor() = default;
+
+  virtual bool IsCancelled() const = 0;
+  // Report that `completed` out of `total` items have been processed by the
+  // given stage (e.g., "Simplifying basic blocks")
+  virtual void ReportProgress(const char* stage, size_t completed,
+                              size_t total) = 0;
+};
+
+}  // namespace triton_bn
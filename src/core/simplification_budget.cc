@@ -0,0 +1,101 @@
+#include "simplification_budget.h"
+
+#include <limits>
+#include <unordered_set>
+#include <vector>
+
+namespace triton_bn {
+
+static size_t CountNewAstNodes(const triton::arch::Instruction& instr,
+                               size_t max_count);
+
+BudgetTracker::BudgetTracker(const SimplificationBudget& budget,
+                             AstMemoryGovernor* memory_governor)
+    : budget_(budget), memory_governor_(memory_governor) {
+  if (memory_governor_ != nullptr) {
+    memory_governor_->Enter();
+  }
+  start_ = std::chrono::steady_clock::now();
+}
+
+BudgetTracker::~BudgetTracker() {
+  if (memory_governor_ != nullptr) {
+    memory_governor_->Leave(ast_node_count_);
+  }
+}
+
+bool BudgetTracker::Charge(const triton::arch::Instruction& instr) {
+  if (exceeded_) {
+    return false;
+  }
+
+  if (budget_.ast_node_limit != 0 || memory_governor_ != nullptr) {
+    const size_t max_count =
+        budget_.ast_node_limit != 0
+            ? budget_.ast_node_limit - ast_node_count_ + 1
+            : std::numeric_limits<size_t>::max();
+    const size_t node_count = CountNewAstNodes(instr, max_count);
+    if (memory_governor_ != nullptr) {
+      // Note: Time spent waiting for memory isn't charged to the time limit
+      const auto wait_start = std::chrono::steady_clock::now();
+      const bool charged =
+          memory_governor_->Charge(ast_node_count_, node_count);
+      start_ += std::chrono::steady_clock::now() - wait_start;
+      if (!charged) {
+        exceeded_ = true;
+        return false;
+      }
+    }
+    ast_node_count_ += node_count;
+    if (budget_.ast_node_limit != 0 &&
+        ast_node_count_ > budget_.ast_node_limit) {
+      exceeded_ = true;
+      return false;
+    }
+  }
+  return Check();
+}
+
+bool BudgetTracker::Check() {
+  if (exceeded_) {
+    return false;
+  }
+
+  if (budget_.time_limit_ms != 0) {
+    const auto elapsed = std::chrono::steady_clock::now() - start_;
+    if (elapsed >= std::chrono::milliseconds(budget_.time_limit_ms)) {
+      exceeded_ = true;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Count the AST nodes of the symbolic expressions built by `instr`, stopping
+// at `max_count`.
+// Note: Operands that come from previous instructions are reference nodes,
+// the walk stops there so that each node is only counted by the instruction
+// that built it.
+static size_t CountNewAstNodes(const triton::arch::Instruction& instr,
+                               size_t max_count) {
+  std::unordered_set<const triton::ast::AbstractNode*> visited_nodes{};
+  std::vector<triton::ast::AbstractNode*> pending_nodes{};
+  for (const auto& expr : instr.symbolicExpressions) {
+    pending_nodes.push_back(expr->getAst().get());
+  }
+  while (!pending_nodes.empty() && visited_nodes.size() < max_count) {
+    triton::ast::AbstractNode* node = pending_nodes.back();
+    pending_nodes.pop_back();
+    if (node == nullptr || !visited_nodes.insert(node).second ||
+        node->getType() == triton::ast::REFERENCE_NODE) {
+      continue;
+    }
+    for (const auto& child : node->getChildren()) {
+      pending_nodes.push_back(child.get());
+    }
+  }
+
+  return visited_nodes.size();
+}
+
+}  // namespace triton_bn
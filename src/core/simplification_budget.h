@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <triton/instruction.hpp>
+
+#include "ast_memory_governor.h"
+
+namespace triton_bn {
+
+// What's left of a basic block whose simplification runs over budget
+enum class BudgetFallback {
+  // Only remove NOP-like instructions
+  kNopLikeRemoval,
+  // Keep the basic block as is
+  kUnchanged,
+};
+
+// Limits on the work spent simplifying a single basic block, 0 means no limit
+struct SimplificationBudget {
+  // Wall-clock time spent on dead store elimination, in milliseconds
+  uint64_t time_limit_ms = 0;
+  // Number of AST nodes built while executing the basic block symbolically
+  size_t ast_node_limit = 0;
+  BudgetFallback fallback = BudgetFallback::kNopLikeRemoval;
+
+  bool IsLimited() const { return time_limit_ms != 0 || ast_node_limit != 0; }
+};
+
+// Accounts the work spent simplifying a basic block against a
+// `SimplificationBudget`, and its AST nodes against `memory_governor`'s
+// ceiling (if not null). The clock starts when the tracker is created, after
+// waiting for `memory_governor` to have room for the basic block, and is
+// paused while waiting for other basic blocks to release memory. AST nodes
+// are released from `memory_governor` when the tracker is destroyed, which
+// must happen once the basic block's symbolic state has been freed.
+// Note: Triton can't be interrupted, limits are checked between instructions
+// and may be exceeded by the cost of a single one.
+class BudgetTracker {
+ public:
+  explicit BudgetTracker(const SimplificationBudget& budget,
+                         AstMemoryGovernor* memory_governor = nullptr);
+  ~BudgetTracker();
+  BudgetTracker(const BudgetTracker&) = delete;
+  BudgetTracker& operator=(const BudgetTracker&) = delete;
+
+  const SimplificationBudget& budget() const { return budget_; }
+  bool IsExceeded() const { return exceeded_; }
+
+  // Account for the AST nodes built by executing `instr`. Returns false once
+  // a limit has been exceeded.
+  bool Charge(const triton::arch::Instruction& instr);
+  // Check the time limit only. Returns false once a limit has been exceeded.
+  bool Check();
+
+ private:
+  const SimplificationBudget budget_;
+  AstMemoryGovernor* const memory_governor_;
+  std::chrono::steady_clock::time_point start_{};
+  size_t ast_node_count_ = 0;
+  bool exceeded_ = false;
+};
+
+}  // namespace triton_bn
@@ -0,0 +1,68 @@
+#include "simplification_cache.h"
+
+#include "call_summary.h"
+#include "meta_basic_block.h"
+
+namespace triton_bn {
+
+SimplificationCache::Key SimplificationCache::MakeKey(
+    MetaBasicBlock& meta_bb, bool padding, size_t max_rounds,
+    const CallSummary* call_summary) {
+  Key key{};
+  const auto& instructions = meta_bb.triton_bb().getInstructions();
+  if (instructions.empty()) {
+    return key;
+  }
+
+  key.start = instructions[0].getAddress();
+  key.padding = padding;
+  key.function_start = meta_bb.function_start();
+
+  // FNV-1a
+  uint64_t fingerprint = 0xcbf29ce484222325ULL;
+  auto hash_value = [&fingerprint](uint64_t value) {
+    for (size_t i = 0; i < sizeof(value); i++) {
+      fingerprint ^= (value >> (i * 8)) & 0xff;
+      fingerprint *= 0x100000001b3ULL;
+    }
+  };
+  auto hash_register_set = [&hash_value](const RegisterSet& registers) {
+    hash_value(registers.words().size());
+    for (const uint64_t word : registers.words()) {
+      hash_value(word);
+    }
+  };
+  for (const auto& instr : instructions) {
+    const uint64_t instr_start = instr.getAddress();
+    const uint64_t instr_end = instr_start + instr.getSize();
+    hash_value(instr_start);
+    hash_value(instr.getSize());
+
+    // Coalesce contiguous instructions
+    if (!key.ranges.empty() && key.ranges.back().second == instr_start) {
+      key.ranges.back().second = instr_end;
+    } else {
+      key.ranges.emplace_back(instr_start, instr_end);
+    }
+  }
+  // Note: The result depends on which registers are live at the end
+  if (meta_bb.live_out().has_value()) {
+    hash_register_set(*meta_bb.live_out());
+  }
+  // Note: Only hashed for multiple rounds, so that single-round keys match the
+  // ones of results persisted before rounds could be configured
+  if (max_rounds > 1) {
+    hash_value(max_rounds);
+  }
+  // Note: Calls are simplified across (and the live-out registers computed)
+  // according to the calling convention, which is described by these
+  if (call_summary != nullptr) {
+    hash_register_set(call_summary->argument_registers);
+    hash_register_set(call_summary->clobbered_registers);
+  }
+  key.fingerprint = fingerprint;
+
+  return key;
+}
+
+}  // namespace triton_bn
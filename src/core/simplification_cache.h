@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <triton/basicBlock.hpp>
+#include <utility>
+#include <vector>
+
+namespace triton_bn {
+
+struct CallSummary;
+struct MetaBasicBlock;
+
+// Interface of the caches used to reuse the results of previous
+// simplifications of `MetaBasicBlock`s. It's up to implementations to decide
+// when results become outdated.
+class SimplificationCache {
+ public:
+  using AddressRange = std::pair<uint64_t, uint64_t>;
+
+  // Describes a `MetaBasicBlock`'s content before simplification
+  struct Key {
+    uint64_t start = 0;
+    bool padding = false;
+    // Hash of the addresses and sizes of the input instructions, of the
+    // live-out registers, of the number of rounds and of the registers calls
+    // are summarized with
+    uint64_t fingerprint = 0;
+    uint64_t function_start = 0;
+    // Address ranges the input instructions were read from
+    std::vector<AddressRange> ranges{};
+
+    bool IsValid() const { return !ranges.empty(); }
+  };
+
+  virtual ~SimplificationCache() = default;
+
+  // `call_summary` is the one basic blocks are simplified with, if any
+  // Note: Returns an invalid key for empty basic blocks, which aren't cached
+  static Key MakeKey(MetaBasicBlock& meta_bb, bool padding,
+                     size_t max_rounds = 1,
+                     const CallSummary* call_summary = nullptr);
+
+  // Retrieve the simplified version of a basic block, if it's been computed
+  // before and is still up to date
+  virtual bool Lookup(const Key& key,
+                      triton::arch::BasicBlock& simplified_bb) = 0;
+  virtual void Store(const Key& key,
+                     const triton::arch::BasicBlock& simplified_bb) = 0;
+};
+
+}  // namespace triton_bn
@@ -0,0 +1,441 @@
+#include "simplification_pipeline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "bounded_queue.h"
+#include "cfg_builder.h"
+#include "instrumentation.h"
+#include "liveness.h"
+#include "log.h"
+#include "work_stealing_scheduler.h"
+
+namespace triton_bn {
+
+bool CfgExtractionSource::Next(std::vector<MetaBasicBlock>& pieces) {
+  if (next_index_ >= cfg_.block_count()) {
+    return false;
+  }
+
+  pieces = ExtractMetaBasicBlocksFromBasicBlock(code_, cfg_, next_index_++,
+                                                triton_, split_at_calls_);
+  return true;
+}
+
+// Note: The pieces of a basic block are contiguous
+MetaBasicBlockListSource::MetaBasicBlockListSource(
+    std::vector<MetaBasicBlock> basic_blocks)
+    : basic_blocks_(std::move(basic_blocks)) {
+  for (size_t i = 0; i < basic_blocks_.size(); i++) {
+    if (i == 0 ||
+        basic_blocks_[i].GetStart() != basic_blocks_[i - 1].GetStart()) {
+      group_count_++;
+    }
+  }
+}
+
+bool MetaBasicBlockListSource::Next(std::vector<MetaBasicBlock>& pieces) {
+  if (next_index_ >= basic_blocks_.size()) {
+    return false;
+  }
+
+  pieces.clear();
+  const uint64_t start = basic_blocks_[next_index_].GetStart();
+  while (next_index_ < basic_blocks_.size() &&
+         basic_blocks_[next_index_].GetStart() == start) {
+    pieces.emplace_back(std::move(basic_blocks_[next_index_++]));
+  }
+  return true;
+}
+
+FunctionExtractionSource::FunctionExtractionSource(
+    const CodeSource& code, const ControlFlowGraph& cfg,
+    triton::Context& triton, bool merge_basic_blocks,
+    bool cross_block_liveness, const CallSummary* call_summary)
+    : code_(code),
+      cfg_(cfg),
+      triton_(triton),
+      merge_basic_blocks_(merge_basic_blocks),
+      call_summary_(call_summary) {
+  if (cross_block_liveness) {
+    liveness_.emplace(triton, cfg, call_summary);
+  }
+  const uint32_t bb_count = cfg.block_count();
+
+  // Chain the basic blocks, following the rules of `MergeMetaBasicBlocks`
+  // (which merges the extracted chains), each basic block is then its own
+  // chain if merging is disabled
+  std::vector<uint32_t> next_blocks(bb_count, kInvalidBlockIndex);
+  std::vector<uint8_t> is_chained(bb_count, 0);
+  for (uint32_t i = 0; merge_basic_blocks && i < bb_count; i++) {
+    const uint32_t edge_index = cfg.edges_begin(i);
+    if (cfg.edges_end(i) - edge_index != 1 ||
+        cfg.edge_types[edge_index] != BranchType::kUnconditional) {
+      continue;
+    }
+    const uint32_t target = cfg.edge_targets[edge_index];
+    if (target == kInvalidBlockIndex || target == i ||
+        cfg.incoming_edge_counts[target] != 1) {
+      continue;
+    }
+    next_blocks[i] = target;
+    is_chained[target] = 1;
+  }
+  // Basic blocks of each chain, indexed by `chain_offsets`
+  std::vector<uint32_t> chains(bb_count, kInvalidBlockIndex);
+  std::vector<uint32_t> chain_offsets{0};
+  std::vector<uint32_t> chain_blocks{};
+  // Note: Cycles of chained basic blocks are broken at the first basic block
+  // found, as `MergeMetaBasicBlocks` does since they're extracted in order
+  for (const bool cycles : {false, true}) {
+    for (uint32_t i = 0; i < bb_count; i++) {
+      if (chains[i] != kInvalidBlockIndex || (!cycles && is_chained[i])) {
+        continue;
+      }
+      for (uint32_t j = i; j != kInvalidBlockIndex &&
+                           chains[j] == kInvalidBlockIndex;
+           j = next_blocks[j]) {
+        chains[j] = static_cast<uint32_t>(chain_count_);
+        chain_blocks.push_back(j);
+      }
+      chain_offsets.push_back(static_cast<uint32_t>(chain_blocks.size()));
+      chain_count_++;
+    }
+  }
+
+  // Chains each chain branches to, indexed by `succ_offsets`
+  std::vector<uint32_t> succ_offsets(chain_count_ + 1, 0);
+  std::vector<uint32_t> succ_chains{};
+  for (size_t chain = 0; chain < chain_count_; chain++) {
+    for (uint32_t i = chain_offsets[chain]; i < chain_offsets[chain + 1];
+         i++) {
+      const uint32_t bb_index = chain_blocks[i];
+      for (uint32_t edge_index = cfg.edges_begin(bb_index);
+           edge_index < cfg.edges_end(bb_index); edge_index++) {
+        const uint32_t target = cfg.edge_targets[edge_index];
+        if (target != kInvalidBlockIndex && chains[target] != chain) {
+          succ_chains.push_back(chains[target]);
+        }
+      }
+    }
+    succ_offsets[chain + 1] = static_cast<uint32_t>(succ_chains.size());
+  }
+
+  // Tarjan's algorithm, which finds strongly connected components successors
+  // first.
+  // Note: Iterative, CFGs can be deep enough to overflow the stack
+  std::vector<uint32_t> dfs_indexes(chain_count_, kInvalidBlockIndex);
+  std::vector<uint32_t> low_links(chain_count_, 0);
+  std::vector<uint8_t> on_stack(chain_count_, 0);
+  std::vector<uint32_t> component_stack{};
+  // Chain, position of the next successor to visit in `succ_chains`
+  std::vector<std::pair<uint32_t, uint32_t>> dfs_stack{};
+  uint32_t next_dfs_index = 0;
+  auto visit = [&](uint32_t chain) {
+    dfs_indexes[chain] = low_links[chain] = next_dfs_index++;
+    on_stack[chain] = 1;
+    component_stack.push_back(chain);
+    dfs_stack.emplace_back(chain, succ_offsets[chain]);
+  };
+  component_offsets_.push_back(0);
+  for (uint32_t root = 0; root < chain_count_; root++) {
+    if (dfs_indexes[root] != kInvalidBlockIndex) {
+      continue;
+    }
+    visit(root);
+    while (!dfs_stack.empty()) {
+      const uint32_t chain = dfs_stack.back().first;
+      const uint32_t succ_index = dfs_stack.back().second;
+      if (succ_index < succ_offsets[chain + 1]) {
+        dfs_stack.back().second++;
+        const uint32_t succ = succ_chains[succ_index];
+        if (dfs_indexes[succ] == kInvalidBlockIndex) {
+          visit(succ);
+        } else if (on_stack[succ]) {
+          low_links[chain] = std::min(low_links[chain], dfs_indexes[succ]);
+        }
+        continue;
+      }
+
+      dfs_stack.pop_back();
+      if (!dfs_stack.empty()) {
+        const uint32_t parent = dfs_stack.back().first;
+        low_links[parent] = std::min(low_links[parent], low_links[chain]);
+      }
+      if (low_links[chain] != dfs_indexes[chain]) {
+        continue;
+      }
+      // `chain` is the root of a component, made of what's above it
+      uint32_t member = kInvalidBlockIndex;
+      do {
+        member = component_stack.back();
+        component_stack.pop_back();
+        on_stack[member] = 0;
+        component_blocks_.insert(
+            std::end(component_blocks_),
+            std::begin(chain_blocks) + chain_offsets[member],
+            std::begin(chain_blocks) + chain_offsets[member + 1]);
+      } while (member != chain);
+      component_offsets_.push_back(
+          static_cast<uint32_t>(component_blocks_.size()));
+    }
+  }
+}
+
+bool FunctionExtractionSource::Next(std::vector<MetaBasicBlock>& pieces) {
+  while (!pending_.Next(pieces)) {
+    if (next_component_ + 1 >= component_offsets_.size()) {
+      return false;
+    }
+
+    // Extract the next component as a whole
+    std::vector<MetaBasicBlock> basic_blocks{};
+    for (uint32_t i = component_offsets_[next_component_];
+         i < component_offsets_[next_component_ + 1]; i++) {
+      auto bb_pieces = ExtractMetaBasicBlocksFromBasicBlock(
+          code_, cfg_, component_blocks_[i], triton_,
+          call_summary_ == nullptr);
+      std::move(std::begin(bb_pieces), std::end(bb_pieces),
+                std::back_inserter(basic_blocks));
+    }
+    next_component_++;
+
+    if (merge_basic_blocks_) {
+      basic_blocks = MergeMetaBasicBlocks(cfg_, std::move(basic_blocks));
+    }
+    if (liveness_.has_value()) {
+      liveness_->Analyze(basic_blocks);
+    }
+    pending_ = MetaBasicBlockListSource(std::move(basic_blocks));
+  }
+  return true;
+}
+
+bool RunSimplificationPipeline(const triton::Context& triton,
+                               MetaBasicBlockSource& source,
+                               const MetaBasicBlockSink& sink,
+                               const SimplificationOptions& options) {
+  BoundedQueue<std::vector<MetaBasicBlock>> input_queue(options.queue_depth);
+  BoundedQueue<MetaBasicBlock> output_queue(options.queue_depth);
+  ProgressMonitor* monitor = options.monitor;
+  std::atomic<bool> failed{false};
+  // Stop all stages, whatever they're waiting for
+  auto abort = [&]() {
+    input_queue.Abort();
+    output_queue.Abort();
+  };
+
+  // Note: Stages run on their own threads, which must record their events
+  // with the caller's
+  Instrumentation& instrumentation = Instrumentation::Current();
+
+  // Note: Runs on its own thread so that reading code overlaps with the rest
+  std::thread producer([&]() {
+    ScopedInstrumentation scoped_instrumentation(instrumentation);
+    std::vector<MetaBasicBlock> pieces{};
+    while (source.Next(pieces)) {
+      if (pieces.empty()) {
+        continue;
+      }
+      if (!input_queue.Push(std::move(pieces))) {
+        break;
+      }
+      pieces = {};
+    }
+    input_queue.Close();
+  });
+
+  size_t worker_count = options.worker_count;
+  if (worker_count == 0) {
+    worker_count = std::max(1U, std::thread::hardware_concurrency());
+  }
+  std::atomic<size_t> running_worker_count{worker_count};
+  const auto triton_arch = triton.getArchitecture();
+  auto simplification_worker = [&]() {
+    ScopedInstrumentation scoped_instrumentation(instrumentation);
+    // Intialize Triton's context
+    triton::Context triton{};
+    triton.setArchitecture(triton_arch);
+    CountEvent(Counter::kTritonContexts);
+
+    std::vector<MetaBasicBlock> pieces{};
+    while (input_queue.Pop(pieces)) {
+      if (monitor != nullptr && monitor->IsCancelled()) {
+        abort();
+        break;
+      }
+
+      bool simplified = true;
+      for (auto& piece : pieces) {
+        if (!SimplifyMetaBasicBlock(triton, piece, options)) {
+          simplified = false;
+          break;
+        }
+      }
+      if (!simplified) {
+        failed = true;
+        abort();
+        break;
+      }
+
+      // Regroup split simplified basic blocks
+      MetaBasicBlock& meta_bb = pieces[0];
+      for (size_t i = 1; i < pieces.size(); i++) {
+        for (auto& instr : pieces[i].triton_bb().getInstructions()) {
+          meta_bb.triton_bb().add(instr);
+        }
+        if (pieces[i].over_budget()) {
+          meta_bb.set_over_budget(true);
+        }
+      }
+      if (!output_queue.Push(std::move(meta_bb))) {
+        break;
+      }
+    }
+
+    // The last worker out signals the end of the results
+    if (--running_worker_count == 0) {
+      output_queue.Close();
+    }
+  };
+  std::vector<std::thread> workers{};
+  for (size_t i = 0; i < worker_count; i++) {
+    workers.emplace_back(simplification_worker);
+  }
+
+  // Consume results as they come
+  const size_t total = source.size();
+  size_t completed_count = 0;
+  bool cancelled = false;
+  MetaBasicBlock meta_bb{};
+  while (output_queue.Pop(meta_bb)) {
+    if (monitor != nullptr) {
+      if (monitor->IsCancelled()) {
+        cancelled = true;
+        abort();
+        break;
+      }
+      monitor->ReportProgress("Simplifying basic blocks", completed_count,
+                              total);
+    }
+    sink(std::move(meta_bb));
+    completed_count++;
+  }
+
+  producer.join();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  if (cancelled || (monitor != nullptr && monitor->IsCancelled())) {
+    return false;
+  }
+  if (failed) {
+    LogMessage(LogLevel::kError,
+               "Failed to simplify function (%zu basic block(s) completed)",
+               completed_count);
+    return false;
+  }
+
+  if (monitor != nullptr) {
+    monitor->ReportProgress("Simplifying basic blocks", completed_count,
+                            completed_count);
+  }
+  return true;
+}
+
+std::vector<std::vector<MetaBasicBlock>> SimplifyFunctions(
+    const CodeSource& code, triton::arch::architecture_e architecture,
+    std::vector<ControlFlowGraph>& cfgs, const FunctionBatchOptions& options,
+    const FunctionBatchCallbacks& callbacks) {
+  std::vector<std::vector<MetaBasicBlock>> simplified_functions(cfgs.size());
+
+  // Function index, size in bytes
+  std::vector<std::pair<size_t, uint64_t>> functions{};
+  functions.reserve(cfgs.size());
+  for (size_t i = 0; i < cfgs.size(); i++) {
+    const ControlFlowGraph& cfg = cfgs[i];
+    uint64_t function_size = cfg.block_count() == 0 ? UINT64_MAX : 0;
+    for (size_t j = 0; j < cfg.block_count(); j++) {
+      function_size += cfg.block_ends[j] - cfg.block_starts[j];
+    }
+    functions.emplace_back(i, function_size);
+  }
+  std::stable_sort(std::begin(functions), std::end(functions),
+                   [](const auto& lhs, const auto& rhs) {
+                     return lhs.second > rhs.second;
+                   });
+
+  WorkStealingScheduler scheduler(options.worker_count);
+  // Note: Functions are already processed in parallel
+  SimplificationOptions simplification_options = options.simplification;
+  simplification_options.worker_count = 1;
+  ProgressMonitor* monitor = simplification_options.monitor;
+  const CallSummary* call_summary =
+      simplification_options.call_summary.has_value()
+          ? &*simplification_options.call_summary
+          : nullptr;
+
+  // One Triton context per worker
+  std::vector<std::unique_ptr<triton::Context>> triton_contexts{};
+  for (size_t i = 0; i < scheduler.worker_count(); i++) {
+    triton_contexts.emplace_back(
+        std::make_unique<triton::Context>(architecture));
+    CountEvent(Counter::kTritonContexts);
+  }
+
+  std::vector<WorkStealingScheduler::Task> tasks{};
+  tasks.reserve(functions.size());
+  for (const auto& function : functions) {
+    const size_t i = function.first;
+    tasks.emplace_back([&, i](size_t worker_index) {
+      if (monitor != nullptr && monitor->IsCancelled()) {
+        return;
+      }
+
+      triton::Context& triton = *triton_contexts[worker_index];
+      ControlFlowGraph& cfg = cfgs[i];
+      if (cfg.block_count() == 0) {
+        cfg = RecoverControlFlowGraph(code, cfg.function_start, triton);
+      }
+      if (callbacks.before_extraction) {
+        callbacks.before_extraction(i, cfg);
+      }
+
+      auto meta_basic_blocks = ExtractMetaBasicBlocksFromFunction(
+          code, cfg, triton, monitor, call_summary == nullptr);
+      if (callbacks.on_extracted) {
+        callbacks.on_extracted(i, meta_basic_blocks);
+      }
+      if (options.merge_basic_blocks) {
+        meta_basic_blocks =
+            MergeMetaBasicBlocks(cfg, std::move(meta_basic_blocks), monitor);
+      }
+      if (options.cross_block_liveness) {
+        ComputeLiveOutRegisters(triton, cfg, meta_basic_blocks, call_summary,
+                                monitor);
+      }
+      simplified_functions[i] = SimplifyMetaBasicBlocks(
+          triton, std::move(meta_basic_blocks), simplification_options);
+      if (monitor != nullptr && monitor->IsCancelled()) {
+        simplified_functions[i].clear();
+        return;
+      }
+      if (simplified_functions[i].empty()) {
+        LogMessage(LogLevel::kError, "Failed to simplify function at 0x%p",
+                   (void*)cfg.function_start);
+      }
+      if (callbacks.on_simplified) {
+        callbacks.on_simplified(i, simplified_functions[i]);
+      }
+    });
+  }
+  scheduler.Run(std::move(tasks));
+
+  return simplified_functions;
+}
+
+}  // namespace triton_bn
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <triton/context.hpp>
+#include <vector>
+
+#include "cfg.h"
+#include "code_source.h"
+#include "liveness.h"
+#include "meta_basic_block.h"
+
+namespace triton_bn {
+
+// Produces the basic blocks fed to `RunSimplificationPipeline`, one at a time
+class MetaBasicBlockSource {
+ public:
+  virtual ~MetaBasicBlockSource() = default;
+
+  // Number of basic blocks produced in total, used to report progress
+  virtual size_t size() const = 0;
+  // Produce the next basic block, along with all the `MetaBasicBlock`s it's
+  // been split into. Returns false once there's nothing left.
+  virtual bool Next(std::vector<MetaBasicBlock>& pieces) = 0;
+};
+
+// Extracts the basic blocks of `cfg` on demand, in CFG order
+class CfgExtractionSource : public MetaBasicBlockSource {
+ public:
+  CfgExtractionSource(const CodeSource& code, const ControlFlowGraph& cfg,
+                      triton::Context& triton, bool split_at_calls = true)
+      : code_(code),
+        cfg_(cfg),
+        triton_(triton),
+        split_at_calls_(split_at_calls) {}
+
+  size_t size() const override { return cfg_.block_count(); }
+  bool Next(std::vector<MetaBasicBlock>& pieces) override;
+
+ private:
+  const CodeSource& code_;
+  const ControlFlowGraph& cfg_;
+  triton::Context& triton_;
+  bool split_at_calls_;
+  uint32_t next_index_ = 0;
+};
+
+// Hands out already extracted (and possibly merged) `MetaBasicBlock`s,
+// regrouped by basic block
+class MetaBasicBlockListSource : public MetaBasicBlockSource {
+ public:
+  explicit MetaBasicBlockListSource(std::vector<MetaBasicBlock> basic_blocks);
+
+  size_t size() const override { return group_count_; }
+  bool Next(std::vector<MetaBasicBlock>& pieces) override;
+
+ private:
+  std::vector<MetaBasicBlock> basic_blocks_;
+  size_t group_count_ = 0;
+  size_t next_index_ = 0;
+};
+
+// Extracts the basic blocks of `cfg` on demand, merges chains of basic blocks
+// and computes their live-out registers (see `MergeMetaBasicBlocks` and
+// `LivenessAnalysis`) as enabled, so that these overlap with simplification as
+// well. Basic blocks are split at calls, unless `call_summary` is set.
+// Note: Basic blocks are extracted by strongly connected component of the
+// graph of chains, successors first, so that the liveness of each component
+// is known once it's extracted. Components are then handed out by chain.
+class FunctionExtractionSource : public MetaBasicBlockSource {
+ public:
+  FunctionExtractionSource(const CodeSource& code, const ControlFlowGraph& cfg,
+                           triton::Context& triton, bool merge_basic_blocks,
+                           bool cross_block_liveness,
+                           const CallSummary* call_summary = nullptr);
+
+  size_t size() const override { return chain_count_; }
+  bool Next(std::vector<MetaBasicBlock>& pieces) override;
+
+ private:
+  const CodeSource& code_;
+  const ControlFlowGraph& cfg_;
+  triton::Context& triton_;
+  bool merge_basic_blocks_;
+  const CallSummary* call_summary_;
+  std::optional<LivenessAnalysis> liveness_{};
+  size_t chain_count_ = 0;
+  // CFG indexes of the basic blocks of each component, in extraction order,
+  // indexed by `component_offsets_`
+  std::vector<uint32_t> component_offsets_{};
+  std::vector<uint32_t> component_blocks_{};
+  size_t next_component_ = 0;
+  // What's left to hand out of the last extracted component
+  MetaBasicBlockListSource pending_{std::vector<MetaBasicBlock>{}};
+};
+
+// Receives simplified basic blocks, with their pieces regrouped
+using MetaBasicBlockSink = std::function<void(MetaBasicBlock meta_bb)>;
+
+// Stream the basic blocks of `source` through `options.worker_count`
+// simplification workers into `sink`, so that reading code, simplifying it and
+// consuming the results overlap. Stages are connected with queues holding at
+// most `options.queue_depth` basic blocks, which keeps memory usage bounded.
+// `source` is run on a dedicated thread and `sink` on the calling thread, basic
+// blocks reach `sink` in completion order.
+// Returns false, after stopping all stages, if a basic block fails to be
+// simplified or if `options.monitor` is cancelled.
+bool RunSimplificationPipeline(const triton::Context& triton,
+                               MetaBasicBlockSource& source,
+                               const MetaBasicBlockSink& sink,
+                               const SimplificationOptions& options);
+
+struct FunctionBatchOptions {
+  // Number of functions simplified in parallel, 0 means one per hardware
+  // thread
+  size_t worker_count = 0;
+  bool merge_basic_blocks = true;
+  bool cross_block_liveness = true;
+  // Options the basic blocks of each function are simplified with, on a single
+  // thread. `simplification.monitor` is also notified while functions are
+  // extracted and analyzed, and stops the whole batch when cancelled.
+  SimplificationOptions simplification{};
+};
+
+// Optional callbacks of `SimplifyFunctions`, called from its workers with the
+// index of the function they're about
+struct FunctionBatchCallbacks {
+  // Before the function's basic blocks are extracted, once its CFG is known
+  std::function<void(size_t index, const ControlFlowGraph& cfg)>
+      before_extraction{};
+  // Once the function's basic blocks are extracted, before they're merged
+  std::function<void(size_t index,
+                     const std::vector<MetaBasicBlock>& basic_blocks)>
+      on_extracted{};
+  // Once the function has been simplified, `basic_blocks` is empty if it
+  // failed to be
+  std::function<void(size_t index,
+                     const std::vector<MetaBasicBlock>& basic_blocks)>
+      on_simplified{};
+};
+
+// Simplify whole functions in parallel, one task per function and one Triton
+// context per worker: basic blocks are extracted, merged, their liveness is
+// computed and they're simplified, as enabled by `options`.
+// The biggest functions are processed first, which gives the best load
+// balancing with the work-stealing scheduler. Functions whose CFG is empty get
+// it recovered from `code` (see `RecoverControlFlowGraph`), their size is
+// unknown so they come first.
+// Returns the simplified basic blocks of each function, in `cfgs` order. They
+// are empty for functions that failed to be simplified, or weren't because
+// `options.simplification.monitor` was cancelled.
+std::vector<std::vector<MetaBasicBlock>> SimplifyFunctions(
+    const CodeSource& code, triton::arch::architecture_e architecture,
+    std::vector<ControlFlowGraph>& cfgs, const FunctionBatchOptions& options,
+    const FunctionBatchCallbacks& callbacks = {});
+
+}  // namespace triton_bn
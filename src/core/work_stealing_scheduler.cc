@@ -0,0 +1,85 @@
+#include "work_stealing_scheduler.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "instrumentation.h"
+
+namespace triton_bn {
+
+WorkStealingScheduler::WorkStealingScheduler(size_t worker_count)
+    : worker_count_(worker_count) {
+  if (worker_count_ == 0) {
+    worker_count_ = std::max(1U, std::thread::hardware_concurrency());
+  }
+  for (size_t i = 0; i < worker_count_; i++) {
+    queues_.emplace_back(std::make_unique<WorkerQueue>());
+  }
+}
+
+void WorkStealingScheduler::Run(std::vector<Task> tasks) {
+  // Deal tasks to the workers' queues
+  for (size_t i = 0; i < tasks.size(); i++) {
+    queues_[i % worker_count_]->task_indices.push_back(i);
+  }
+
+  // Note: Workers record their events with the caller's
+  Instrumentation& instrumentation = Instrumentation::Current();
+  auto worker = [&](size_t worker_index) {
+    ScopedInstrumentation scoped_instrumentation(instrumentation);
+    size_t task_index = 0;
+    // Note: No task is submitted while running, so the batch is over once
+    // there's nothing left to steal
+    while (PopLocalTask(worker_index, task_index) ||
+           StealTask(worker_index, task_index)) {
+      tasks[task_index](worker_index);
+    }
+  };
+
+  // Don't spawn more threads than there are tasks. The calling thread acts as
+  // the first worker.
+  const size_t thread_count = std::min(worker_count_, tasks.size());
+  std::vector<std::thread> threads{};
+  for (size_t i = 1; i < thread_count; i++) {
+    threads.emplace_back(worker, i);
+  }
+  worker(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+// Take the next task from the front of the worker's own queue
+bool WorkStealingScheduler::PopLocalTask(size_t worker_index,
+                                         size_t& task_index) {
+  WorkerQueue& queue = *queues_[worker_index];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.task_indices.empty()) {
+    return false;
+  }
+
+  task_index = queue.task_indices.front();
+  queue.task_indices.pop_front();
+  return true;
+}
+
+// Take a task from the back of another worker's queue. Victims are visited
+// starting from the thief's neighbor to avoid having all thieves contend on the
+// same queue.
+bool WorkStealingScheduler::StealTask(size_t thief_index, size_t& task_index) {
+  for (size_t i = 1; i < worker_count_; i++) {
+    WorkerQueue& victim_queue = *queues_[(thief_index + i) % worker_count_];
+    std::lock_guard<std::mutex> lock(victim_queue.mutex);
+    if (victim_queue.task_indices.empty()) {
+      continue;
+    }
+
+    task_index = victim_queue.task_indices.back();
+    victim_queue.task_indices.pop_back();
+    return true;
+  }
+
+  return false;
+}
+
+}  // namespace triton_bn
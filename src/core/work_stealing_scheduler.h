@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace triton_bn {
+
+// Runs a batch of independent tasks on a pool of threads. Each worker owns a
+// queue of tasks and steals tasks from the other workers' queues once its own
+// queue is empty, which keeps all workers busy when task costs vary a lot.
+class WorkStealingScheduler {
+ public:
+  // Tasks receive the index of the worker that runs them, which can be used to
+  // access per-worker state
+  using Task = std::function<void(size_t worker_index)>;
+
+  // `worker_count` set to 0 means one worker per hardware thread
+  explicit WorkStealingScheduler(size_t worker_count = 0);
+
+  size_t worker_count() const { return worker_count_; }
+
+  // Run the given tasks and wait for all of them to complete. Tasks are dealt
+  // to workers in a round-robin fashion and each worker processes its own
+  // queue in order, so submitting the costliest tasks first gives the best
+  // load balancing.
+  void Run(std::vector<Task> tasks);
+
+ private:
+  struct WorkerQueue {
+    std::mutex mutex{};
+    std::deque<size_t> task_indices{};
+  };
+
+  bool PopLocalTask(size_t worker_index, size_t& task_index);
+  bool StealTask(size_t thief_index, size_t& task_index);
+
+  size_t worker_count_;
+  std::vector<std::unique_ptr<WorkerQueue>> queues_{};
+};
+
+}  // namespace triton_bn
@@ -0,0 +1,173 @@
+#include "flow_graph_builder.h"
+
+#include "binja_adapter.h"
+#include "core/basic_block_simplifier.h"
+#include "core/instrumentation.h"
+
+namespace triton_bn {
+
+using namespace BinaryNinja;
+
+// Note: Disassembly is deferred until here, so that only the basic blocks that
+// are displayed pay for it
+std::vector<DisassemblyTextLine> RenderMetaBasicBlock(
+    const triton::Context& triton, MetaBasicBlock& meta_bb) {
+  try {
+    DisassembleTritonBasicBlock(triton, meta_bb.triton_bb());
+  } catch (triton::exceptions::Exception& ex) {
+    LogError("Failed to disassemble basic block at 0x%p: %s",
+             (void*)meta_bb.GetStart(), ex.what());
+  }
+
+  std::vector<DisassemblyTextLine> disassembly_lines{};
+  if (meta_bb.over_budget()) {
+    DisassemblyTextLine line;
+    line.addr = meta_bb.GetStart();
+    line.tokens = {InstructionTextToken(
+        BNInstructionTextTokenType::TextToken,
+        "; simplification ran out of budget, not fully simplified")};
+    disassembly_lines.emplace_back(std::move(line));
+  }
+  const auto& instructions = meta_bb.triton_bb().getInstructions();
+  for (auto& instr : instructions) {
+    InstructionTextToken instr_token(
+        BNInstructionTextTokenType::InstructionToken, instr.getDisassembly(),
+        0, static_cast<size_t>(instr.getSize()));
+    instr_token.address = instr.getAddress();
+
+    {
+      DisassemblyTextLine line;
+      line.addr = instr.getAddress();
+      line.tokens = {instr_token};
+      disassembly_lines.emplace_back(std::move(line));
+    }
+  }
+
+  return disassembly_lines;
+}
+
+void FlowGraphBuilder::AddBasicBlock(const triton::Context& triton,
+                                     MetaBasicBlock& meta_bb) {
+  ScopedStageTimer timer(Stage::kFlowGraphGeneration);
+  AddNode(meta_bb.cfg_index(), meta_bb.last_cfg_index(),
+          RenderMetaBasicBlock(triton, meta_bb));
+}
+
+void FlowGraphBuilder::AddNode(uint32_t cfg_index, uint32_t last_cfg_index,
+                               const std::vector<DisassemblyTextLine>& lines) {
+  if (nodes_.empty()) {
+    nodes_.resize(cfg_.block_count());
+    last_cfg_indexes_.resize(cfg_.block_count(), kInvalidBlockIndex);
+  }
+
+  // Construct new node
+  if (cfg_index >= nodes_.size() || nodes_[cfg_index]) {
+    LogError("Invalid basic block index %u", cfg_index);
+    return;
+  }
+  Ref<FlowGraphNode> node = new FlowGraphNode(flow_graph_);
+  node->SetLines(lines);
+  nodes_[cfg_index] = std::move(node);
+  last_cfg_indexes_[cfg_index] = last_cfg_index;
+  node_count_++;
+}
+
+Ref<FlowGraph> FlowGraphBuilder::Finish() {
+  ScopedStageTimer timer(Stage::kFlowGraphGeneration);
+
+  // Construct graph
+  for (size_t i = 0; i < nodes_.size(); i++) {
+    const Ref<FlowGraphNode>& graph_node = nodes_[i];
+    if (!graph_node) {
+      continue;
+    }
+
+    // Resolve outgoing edges
+    const uint32_t last_index = last_cfg_indexes_[i];
+    const uint32_t edges_end = cfg_.edges_end(last_index);
+    for (uint32_t j = cfg_.edges_begin(last_index); j < edges_end; j++) {
+      const uint32_t target = cfg_.edge_targets[j];
+      if (target == kInvalidBlockIndex || !nodes_[target]) {
+        continue;
+      }
+
+      graph_node->AddOutgoingEdge(ToBinjaBranchType(cfg_.edge_types[j]),
+                                  nodes_[target]);
+    }
+
+    flow_graph_->AddNode(graph_node);
+  }
+
+  return flow_graph_;
+}
+
+Ref<ProgressiveFlowGraph> ProgressiveFlowGraph::Create(
+    const ControlFlowGraph& cfg, const triton::Context& triton,
+    std::vector<MetaBasicBlock>& quick_basic_blocks) {
+  Ref<ProgressiveFlowGraph> graph = new ProgressiveFlowGraph(cfg);
+  graph->lines_.resize(cfg.block_count());
+  graph->last_cfg_indexes_.resize(cfg.block_count(), kInvalidBlockIndex);
+
+  FlowGraphBuilder flow_graph_builder(graph->cfg_, graph.GetPtr());
+  for (auto& meta_bb : quick_basic_blocks) {
+    const uint32_t cfg_index = meta_bb.cfg_index();
+    if (cfg_index >= cfg.block_count()) {
+      continue;
+    }
+    graph->lines_[cfg_index] = RenderMetaBasicBlock(triton, meta_bb);
+    graph->last_cfg_indexes_[cfg_index] = meta_bb.last_cfg_index();
+    flow_graph_builder.AddNode(cfg_index, meta_bb.last_cfg_index(),
+                               graph->lines_[cfg_index]);
+  }
+  flow_graph_builder.Finish();
+  graph->has_node_.resize(cfg.block_count(), false);
+  for (size_t i = 0; i < flow_graph_builder.nodes().size(); i++) {
+    graph->has_node_[i] = flow_graph_builder.nodes()[i] != nullptr;
+  }
+
+  return graph;
+}
+
+void ProgressiveFlowGraph::UpgradeBasicBlock(const triton::Context& triton,
+                                             MetaBasicBlock& meta_bb) {
+  ScopedStageTimer timer(Stage::kFlowGraphGeneration);
+  auto lines = RenderMetaBasicBlock(triton, meta_bb);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint32_t cfg_index = meta_bb.cfg_index();
+  if (cfg_index >= has_node_.size() || !has_node_[cfg_index]) {
+    return;
+  }
+  lines_[cfg_index] = std::move(lines);
+  upgraded_count_++;
+  dirty_ = true;
+}
+
+size_t ProgressiveFlowGraph::upgraded_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return upgraded_count_;
+}
+
+// Note: Called by the UI from its own thread. The new graph has the same nodes
+// and edges as the displayed one, only their content differs. Upgrades that
+// happened since the last update are all picked up at once, so that the graph
+// isn't laid out again for each of them.
+Ref<FlowGraph> ProgressiveFlowGraph::Update() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!dirty_) {
+    return nullptr;
+  }
+  dirty_ = false;
+
+  FlowGraphBuilder flow_graph_builder(cfg_);
+  for (size_t i = 0; i < has_node_.size(); i++) {
+    if (has_node_[i]) {
+      flow_graph_builder.AddNode(static_cast<uint32_t>(i), last_cfg_indexes_[i],
+                                 lines_[i]);
+    }
+  }
+
+  return flow_graph_builder.Finish();
+}
+
+}  // namespace triton_bn
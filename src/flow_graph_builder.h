@@ -0,0 +1,101 @@
+#pragma once
+
+#include <binaryninjaapi.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <triton/context.hpp>
+#include <vector>
+
+#include "core/cfg.h"
+#include "core/meta_basic_block.h"
+
+namespace triton_bn {
+
+// Render the instructions of a simplified basic block as disassembly lines.
+// Instructions that haven't been disassembled yet are, with `triton`.
+std::vector<BinaryNinja::DisassemblyTextLine> RenderMetaBasicBlock(
+    const triton::Context& triton, MetaBasicBlock& meta_bb);
+
+// Builds a `FlowGraph` out of simplified basic blocks, as they come
+// Note: `cfg` is only read once basic blocks are added
+class FlowGraphBuilder {
+ public:
+  explicit FlowGraphBuilder(const ControlFlowGraph& cfg)
+      : FlowGraphBuilder(cfg, new BinaryNinja::FlowGraph()) {}
+  // Add nodes to an existing (empty) graph
+  FlowGraphBuilder(const ControlFlowGraph& cfg,
+                   BinaryNinja::Ref<BinaryNinja::FlowGraph> flow_graph)
+      : cfg_(cfg), flow_graph_(std::move(flow_graph)) {}
+
+  size_t node_count() const { return node_count_; }
+  // CFG index -> node, null for basic blocks that haven't been added
+  const std::vector<BinaryNinja::Ref<BinaryNinja::FlowGraphNode>>& nodes()
+      const {
+    return nodes_;
+  }
+
+  // Create the node of the given basic block, see `RenderMetaBasicBlock`
+  void AddBasicBlock(const triton::Context& triton, MetaBasicBlock& meta_bb);
+  // Create the node of the basic block at `cfg_index` (merged up to
+  // `last_cfg_index`) from already rendered lines
+  void AddNode(uint32_t cfg_index, uint32_t last_cfg_index,
+               const std::vector<BinaryNinja::DisassemblyTextLine>& lines);
+  // Connect the nodes and return the complete graph. Nodes are added in CFG
+  // order, so that the entry point comes first.
+  BinaryNinja::Ref<BinaryNinja::FlowGraph> Finish();
+
+ private:
+  const ControlFlowGraph& cfg_;
+  BinaryNinja::Ref<BinaryNinja::FlowGraph> flow_graph_;
+  // CFG index -> node
+  std::vector<BinaryNinja::Ref<BinaryNinja::FlowGraphNode>> nodes_{};
+  // CFG index -> index of the last basic block merged into the node's
+  std::vector<uint32_t> last_cfg_indexes_{};
+  size_t node_count_ = 0;
+};
+
+// Flow graph displayed right away with the results of a quick simplification,
+// whose basic blocks are upgraded as the full simplification completes.
+// Note: Upgrades can happen from any thread while the graph is displayed, they
+// never touch the displayed nodes. They're only recorded, and the UI picks
+// them up from its own thread through `Update`, which builds a new graph that
+// replaces the displayed one and is laid out again.
+class ProgressiveFlowGraph : public BinaryNinja::FlowGraph {
+ public:
+  // Create the graph with the quickly simplified version of every basic block
+  // Note: Nodes can't be created from the constructor, as they'd take a
+  // reference to the graph before anyone else holds one
+  static BinaryNinja::Ref<ProgressiveFlowGraph> Create(
+      const ControlFlowGraph& cfg, const triton::Context& triton,
+      std::vector<MetaBasicBlock>& quick_basic_blocks);
+
+  // Record the fully simplified version of a basic block, to be displayed
+  // with the next `Update`. Basic blocks that weren't in the initial graph are
+  // ignored.
+  void UpgradeBasicBlock(const triton::Context& triton,
+                         MetaBasicBlock& meta_bb);
+  size_t upgraded_count() const;
+
+  // New graph with the latest version of every basic block, null if nothing
+  // was upgraded since the last update
+  BinaryNinja::Ref<BinaryNinja::FlowGraph> Update() override;
+
+ private:
+  explicit ProgressiveFlowGraph(const ControlFlowGraph& cfg) : cfg_(cfg) {}
+
+  mutable std::mutex mutex_{};
+  // Note: Copied so that the graph can outlive the command that created it
+  const ControlFlowGraph cfg_;
+  // CFG index -> whether the basic block has a node, latest lines and index
+  // of the last basic block merged into the node's
+  std::vector<bool> has_node_{};
+  std::vector<std::vector<BinaryNinja::DisassemblyTextLine>> lines_{};
+  std::vector<uint32_t> last_cfg_indexes_{};
+  size_t upgraded_count_ = 0;
+  // Whether basic blocks were upgraded since the last update
+  bool dirty_ = false;
+};
+
+}  // namespace triton_bn
@@ -1,6 +1,8 @@
 #include <binaryninjaapi.h>
 
+#include "binja_adapter.h"
 #include "commands.h"
+#include "view_simplification_cache.h"
 
 using namespace BinaryNinja;
 
@@ -9,6 +11,8 @@ extern "C" {
 BN_DECLARE_CORE_ABI_VERSION
 
 BINARYNINJAPLUGIN bool CorePluginInit() {
+  triton_bn::InstallBinjaLogSink();
+
   auto settings = Settings::Instance();
   settings->RegisterGroup("triton-bn", "triton-bn");
   settings->RegisterSetting("triton-bn.mergeBasicBlocks", R"({
@@ -17,6 +21,105 @@ BINARYNINJAPLUGIN bool CorePluginInit() {
 		"default" : true,
 		"description" : "Automatically merge basic blocks linked with a single unconditional branch before running the simplification passes on functions."
 	})");
+  settings->RegisterSetting("triton-bn.crossBlockLiveness", R"({
+		"title" : "Use cross-block register liveness",
+		"type" : "boolean",
+		"default" : true,
+		"description" : "Compute which registers and flags are live at the exit of each basic block of a function, so that dead store elimination can remove writes that are never read by the following basic blocks."
+	})");
+  settings->RegisterSetting("triton-bn.callSummaries", R"({
+		"title" : "Simplify basic blocks across calls",
+		"type" : "boolean",
+		"default" : false,
+		"description" : "Model calls with the registers the platform's default calling convention reads and clobbers, instead of splitting basic blocks at each call. Basic blocks are then simplified as a single unit."
+	})");
+  settings->RegisterSetting("triton-bn.progressivePreview", R"({
+		"title" : "Progressive function preview",
+		"type" : "boolean",
+		"default" : true,
+		"description" : "Display a quickly simplified version of the function first (NOPs and comparisons whose flags are overwritten before being read removed, nothing is executed), then refresh it as the full simplification completes."
+	})");
+  settings->RegisterSetting("triton-bn.workerCount", R"({
+		"title" : "Simplification worker count",
+		"type" : "number",
+		"default" : 0,
+		"minValue" : 0,
+		"maxValue" : 256,
+		"description" : "Number of threads used to simplify basic blocks in parallel. 0 means one thread per hardware thread."
+	})");
+  settings->RegisterSetting("triton-bn.maxSimplificationRounds", R"({
+		"title" : "Maximum simplification rounds",
+		"type" : "number",
+		"default" : 1,
+		"minValue" : 1,
+		"maxValue" : 16,
+		"description" : "Repeat dead store elimination and NOP-like instruction removal on each basic block until a round doesn't change it anymore, up to this number of rounds. Removing instructions often exposes new dead stores."
+	})");
+  settings->RegisterSetting("triton-bn.blockTimeBudget", R"({
+		"title" : "Basic block time budget",
+		"type" : "number",
+		"default" : 0,
+		"minValue" : 0,
+		"maxValue" : 3600000,
+		"description" : "Maximum time spent on the dead store elimination of a single basic block, in milliseconds. Basic blocks that run over budget are handled as described by the fallback setting. 0 means no limit."
+	})");
+  settings->RegisterSetting("triton-bn.blockAstNodeBudget", R"({
+		"title" : "Basic block AST node budget",
+		"type" : "number",
+		"default" : 0,
+		"minValue" : 0,
+		"maxValue" : 1000000000,
+		"description" : "Maximum number of AST nodes built while executing a single basic block symbolically. Basic blocks that run over budget are handled as described by the fallback setting. 0 means no limit."
+	})");
+  settings->RegisterSetting("triton-bn.budgetFallback", R"({
+		"title" : "Over-budget basic blocks",
+		"type" : "string",
+		"default" : "nopLikeRemoval",
+		"enum" : ["nopLikeRemoval", "unchanged"],
+		"enumDescriptions" : [
+			"Only remove NOP-like instructions",
+			"Leave the basic block unchanged"
+		],
+		"description" : "What to do with basic blocks whose simplification runs over budget."
+	})");
+  settings->RegisterSetting("triton-bn.memoryBoundedMode", R"({
+		"title" : "Memory-bounded simplification",
+		"type" : "boolean",
+		"default" : false,
+		"description" : "Limit the number of basic blocks in flight and account the memory held by Triton's symbolic state against a ceiling. Basic blocks wait for room before being simplified, and those that would exceed the ceiling on their own are handled as over budget."
+	})");
+  settings->RegisterSetting("triton-bn.symbolicMemoryCeiling", R"({
+		"title" : "Symbolic state memory ceiling",
+		"type" : "number",
+		"default" : 4096,
+		"minValue" : 64,
+		"maxValue" : 1048576,
+		"description" : "Estimated memory, in MiB, that the symbolic state of the basic blocks being simplified may use in memory-bounded mode."
+	})");
+  settings->RegisterSetting("triton-bn.incrementalSimplification", R"({
+		"title" : "Reuse previous simplification results",
+		"type" : "boolean",
+		"default" : true,
+		"description" : "Keep the results of previous simplifications in memory and only recompute basic blocks that have been modified since."
+	})");
+  settings->RegisterSetting("triton-bn.persistResults", R"({
+		"title" : "Save simplification results in the database",
+		"type" : "boolean",
+		"default" : true,
+		"description" : "Store the results of incremental simplification in the database's metadata, so that they can be reused after reopening it. Results are checked against the current bytes when loaded back."
+	})");
+  settings->RegisterSetting("triton-bn.instrumentation", R"({
+		"title" : "Collect performance statistics",
+		"type" : "boolean",
+		"default" : false,
+		"description" : "Time each stage of the simplification pipeline and count processed basic blocks, instructions and bytes. A summary is logged after each command and the full record is stored in the 'triton-bn.instrumentation' view metadata."
+	})");
+
+  // Drop cached simplification results along with their view
+  BinaryViewType::RegisterBinaryViewFinalizationEvent(
+      [](BinaryView* p_view) {
+        triton_bn::ViewSimplificationCache::ReleaseView(p_view);
+      });
 
   // Preview commands
   PluginCommand::Register("triton-bn\\Preview\\Simplify basic block (DSE)",
@@ -36,6 +139,11 @@ BINARYNINJAPLUGIN bool CorePluginInit() {
                           "Simplify function using Triton's DSE pass",
                           triton_bn::SimplifyFunctionPatchCommand,
                           triton_bn::ValidateSimplifyFunctionCommand);
+  PluginCommand::Register(
+      "triton-bn\\Patch\\Simplify all functions (DSE)",
+      "Simplify all functions using Triton's DSE pass, in the background",
+      triton_bn::SimplifyAllFunctionsPatchCommand,
+      triton_bn::ValidateSimplifyFunctionCommand);
 
   return true;
 }
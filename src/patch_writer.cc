@@ -0,0 +1,32 @@
+#include "patch_writer.h"
+
+#include <string>
+
+#include "binja_adapter.h"
+#include "core/instrumentation.h"
+
+namespace triton_bn {
+
+using namespace BinaryNinja;
+
+PatchStatistics WritePatches(BinaryView& view,
+                             std::vector<MetaBasicBlock>& basic_blocks) {
+  ScopedStageTimer timer(Stage::kPatching);
+  PatchStatistics statistics{};
+
+  const std::vector<Patch> patches =
+      BuildPatches(BinaryViewCodeSource(&view), basic_blocks, statistics);
+  if (patches.empty()) {
+    return statistics;
+  }
+
+  const std::string undo_id = view.BeginUndoActions();
+  for (const Patch& patch : patches) {
+    view.Write(patch.address, patch.data.data(), patch.data.size());
+  }
+  view.CommitUndoActions(undo_id);
+
+  return statistics;
+}
+
+}  // namespace triton_bn
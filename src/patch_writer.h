@@ -0,0 +1,19 @@
+#pragma once
+
+#include <binaryninjaapi.h>
+
+#include <vector>
+
+#include "core/meta_basic_block.h"
+#include "core/patch_builder.h"
+
+namespace triton_bn {
+
+// Write the instructions of the given `MetaBasicBlock`s to the view. Only the
+// bytes that differ from the view's current content are written, nearby
+// changes are coalesced into a single write and all the writes are grouped
+// into a single undo action.
+PatchStatistics WritePatches(BinaryNinja::BinaryView& view,
+                             std::vector<MetaBasicBlock>& basic_blocks);
+
+}  // namespace triton_bn
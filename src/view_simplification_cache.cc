@@ -0,0 +1,347 @@
+#include "view_simplification_cache.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+#include "core/persisted_entries.h"
+
+namespace triton_bn {
+
+using namespace BinaryNinja;
+
+static std::mutex g_registry_mutex{};
+static std::unordered_map<BNBinaryView*,
+                          std::unique_ptr<ViewSimplificationCache>>
+    g_registry{};
+
+static std::string GetMetadataKey(uint64_t function_start);
+static bool HashContent(
+    BinaryView& view,
+    const std::vector<SimplificationCache::AddressRange>& ranges,
+    uint64_t& content_hash);
+
+ViewSimplificationCache& ViewSimplificationCache::ForView(BinaryView& view) {
+  std::lock_guard<std::mutex> lock(g_registry_mutex);
+  auto& cache = g_registry[view.GetObject()];
+  if (cache == nullptr) {
+    cache = std::make_unique<ViewSimplificationCache>();
+    view.RegisterNotification(cache.get());
+  }
+
+  return *cache;
+}
+
+void ViewSimplificationCache::ReleaseView(BinaryView* p_view) {
+  std::lock_guard<std::mutex> lock(g_registry_mutex);
+  auto it = g_registry.find(p_view->GetObject());
+  if (it == std::end(g_registry)) {
+    return;
+  }
+
+  p_view->UnregisterNotification(it->second.get());
+  g_registry.erase(it);
+}
+
+void ViewSimplificationCache::PersistView(BinaryView& view) {
+  std::lock_guard<std::mutex> lock(g_registry_mutex);
+  auto it = g_registry.find(view.GetObject());
+  if (it == std::end(g_registry)) {
+    return;
+  }
+
+  it->second->PersistResults(view);
+}
+
+bool ViewSimplificationCache::Lookup(const Key& key,
+                                     triton::arch::BasicBlock& simplified_bb) {
+  if (!key.IsValid()) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = entries_.find({key.start, key.padding});
+  if (it == std::cend(entries_)) {
+    return false;
+  }
+
+  const Entry& entry = it->second;
+  if (entry.dirty || entry.fingerprint != key.fingerprint) {
+    return false;
+  }
+
+  simplified_bb = entry.simplified_bb;
+  return true;
+}
+
+void ViewSimplificationCache::Store(
+    const Key& key, const triton::arch::BasicBlock& simplified_bb) {
+  if (!key.IsValid()) {
+    return;
+  }
+
+  Entry entry{};
+  entry.fingerprint = key.fingerprint;
+  entry.function_start = key.function_start;
+  entry.ranges = key.ranges;
+  entry.simplified_bb = simplified_bb;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  InsertEntry({key.start, key.padding}, std::move(entry));
+  modified_functions_.insert(key.function_start);
+}
+
+void ViewSimplificationCache::LoadPersistedResults(BinaryView& view,
+                                                   uint64_t function_start) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!loaded_functions_.insert(function_start).second) {
+      return;
+    }
+  }
+
+  const Ref<Metadata> record =
+      view.QueryMetadata(GetMetadataKey(function_start));
+  if (!record || !record->IsRaw()) {
+    return;
+  }
+  std::vector<PersistedEntry> persisted_entries{};
+  if (!DeserializePersistedEntries(record->GetRaw(), persisted_entries)) {
+    LogWarn("Ignoring invalid simplification results for function at 0x%p",
+            (void*)function_start);
+    return;
+  }
+
+  size_t loaded_count = 0;
+  for (auto& persisted_entry : persisted_entries) {
+    // Note: Results computed from bytes that have changed since are outdated
+    uint64_t content_hash = 0;
+    if (!HashContent(view, persisted_entry.ranges, content_hash) ||
+        content_hash != persisted_entry.content_hash) {
+      continue;
+    }
+
+    Entry entry{};
+    entry.fingerprint = persisted_entry.fingerprint;
+    entry.function_start = function_start;
+    entry.ranges = std::move(persisted_entry.ranges);
+    // Note: Instructions are only disassembled if they're displayed, see
+    // `DisassembleTritonBasicBlock`
+    uint64_t address = persisted_entry.start;
+    for (const auto& opcode : persisted_entry.opcodes) {
+      const auto size = static_cast<uint32_t>(opcode.size());
+      entry.simplified_bb.add(
+          triton::arch::Instruction(address, opcode.data(), size));
+      address += size;
+    }
+
+    const EntryId id{persisted_entry.start, persisted_entry.padding};
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.count(id) != 0) {
+      continue;
+    }
+    InsertEntry(id, std::move(entry));
+    loaded_count++;
+  }
+  LogDebug("%zu out of %zu persisted result(s) loaded for function at 0x%p",
+           loaded_count, persisted_entries.size(), (void*)function_start);
+}
+
+void ViewSimplificationCache::PersistResults(BinaryView& view) {
+  // Note: Results are copied so that bytes can be read without holding the
+  // lock
+  std::map<uint64_t, std::vector<PersistedEntry>> function_records{};
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const uint64_t function_start : modified_functions_) {
+      auto& persisted_entries = function_records[function_start];
+      const auto [begin_it, end_it] =
+          function_entries_.equal_range(function_start);
+      for (auto it = begin_it; it != end_it; ++it) {
+        auto entry_it = entries_.find(it->second);
+        if (entry_it == std::end(entries_) || entry_it->second.dirty) {
+          continue;
+        }
+
+        Entry& entry = entry_it->second;
+        PersistedEntry persisted_entry{};
+        persisted_entry.start = it->second.first;
+        persisted_entry.padding = it->second.second;
+        persisted_entry.fingerprint = entry.fingerprint;
+        persisted_entry.ranges = entry.ranges;
+        for (const auto& instr : entry.simplified_bb.getInstructions()) {
+          persisted_entry.opcodes.emplace_back(
+              instr.getOpcode(), instr.getOpcode() + instr.getSize());
+        }
+        persisted_entries.emplace_back(std::move(persisted_entry));
+      }
+    }
+    modified_functions_.clear();
+  }
+
+  for (auto& [function_start, persisted_entries] : function_records) {
+    auto it = std::remove_if(
+        std::begin(persisted_entries), std::end(persisted_entries),
+        [&view](PersistedEntry& persisted_entry) {
+          return !HashContent(view, persisted_entry.ranges,
+                              persisted_entry.content_hash);
+        });
+    persisted_entries.erase(it, std::end(persisted_entries));
+
+    const std::string key = GetMetadataKey(function_start);
+    if (persisted_entries.empty()) {
+      view.RemoveMetadata(key);
+      continue;
+    }
+    Ref<Metadata> record =
+        new Metadata(SerializePersistedEntries(persisted_entries));
+    view.StoreMetadata(key, record, true);
+  }
+  LogDebug("Simplification results persisted for %zu function(s)",
+           function_records.size());
+}
+
+void ViewSimplificationCache::OnBinaryDataWritten(BinaryView* /*p_view*/,
+                                                  uint64_t offset, size_t len) {
+  MarkRangeDirty(offset, offset + len);
+}
+
+// Note: Insertions and removals shift everything located after them
+void ViewSimplificationCache::OnBinaryDataInserted(BinaryView* /*p_view*/,
+                                                   uint64_t offset,
+                                                   size_t /*len*/) {
+  MarkRangeDirty(offset, std::numeric_limits<uint64_t>::max());
+}
+
+void ViewSimplificationCache::OnBinaryDataRemoved(BinaryView* /*p_view*/,
+                                                  uint64_t offset,
+                                                  uint64_t /*len*/) {
+  MarkRangeDirty(offset, std::numeric_limits<uint64_t>::max());
+}
+
+// Mark results whose input instructions don't fit in the function's basic
+// blocks anymore as dirty
+void ViewSimplificationCache::OnAnalysisFunctionUpdated(
+    BinaryView* /*p_view*/, Function* p_function) {
+  const uint64_t function_start = p_function->GetStart();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (function_entries_.count(function_start) == 0) {
+      // Nothing cached for this function
+      return;
+    }
+  }
+
+  std::vector<AddressRange> bb_ranges{};
+  for (const auto& basic_block : p_function->GetBasicBlocks()) {
+    bb_ranges.emplace_back(basic_block->GetStart(), basic_block->GetEnd());
+  }
+  std::sort(std::begin(bb_ranges), std::end(bb_ranges));
+
+  auto is_range_in_basic_block = [&bb_ranges](const AddressRange& range) {
+    auto bb_it = std::upper_bound(
+        std::cbegin(bb_ranges), std::cend(bb_ranges),
+        AddressRange{range.first, std::numeric_limits<uint64_t>::max()});
+    if (bb_it == std::cbegin(bb_ranges)) {
+      return false;
+    }
+    --bb_it;
+    return range.first >= bb_it->first && range.second <= bb_it->second;
+  };
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto [begin_it, end_it] = function_entries_.equal_range(function_start);
+  for (auto it = begin_it; it != end_it; ++it) {
+    auto entry_it = entries_.find(it->second);
+    if (entry_it == std::end(entries_)) {
+      continue;
+    }
+
+    Entry& entry = entry_it->second;
+    entry.dirty = entry.dirty || !std::all_of(std::cbegin(entry.ranges),
+                                              std::cend(entry.ranges),
+                                              is_range_in_basic_block);
+  }
+}
+
+// Mark results whose input instructions overlap with `[start, end)` as dirty
+void ViewSimplificationCache::MarkRangeDirty(uint64_t start, uint64_t end) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint64_t lowest_range_start =
+      start > max_range_size_ ? start - max_range_size_ : 0;
+  for (auto it = ranges_.lower_bound(lowest_range_start);
+       it != std::end(ranges_) && it->first < end; ++it) {
+    const uint64_t range_end = it->second.first;
+    if (range_end <= start) {
+      continue;
+    }
+
+    auto entry_it = entries_.find(it->second.second);
+    if (entry_it != std::end(entries_)) {
+      entry_it->second.dirty = true;
+    }
+  }
+}
+
+// Note: `mutex_` must be held. Replaces the previous result, if any.
+void ViewSimplificationCache::InsertEntry(const EntryId& id, Entry entry) {
+  auto it = entries_.find(id);
+  if (it != std::end(entries_)) {
+    RemoveFromIndexes(id, it->second);
+    entries_.erase(it);
+  }
+
+  for (const auto& [range_start, range_end] : entry.ranges) {
+    ranges_.emplace(range_start, std::make_pair(range_end, id));
+    max_range_size_ = std::max(max_range_size_, range_end - range_start);
+  }
+  function_entries_.emplace(entry.function_start, id);
+  entries_.emplace(id, std::move(entry));
+}
+
+void ViewSimplificationCache::RemoveFromIndexes(const EntryId& id,
+                                                const Entry& entry) {
+  for (const auto& range : entry.ranges) {
+    const auto [begin_it, end_it] = ranges_.equal_range(range.first);
+    for (auto it = begin_it; it != end_it;) {
+      it = it->second.second == id ? ranges_.erase(it) : std::next(it);
+    }
+  }
+
+  const auto [begin_it, end_it] =
+      function_entries_.equal_range(entry.function_start);
+  for (auto it = begin_it; it != end_it;) {
+    it = it->second == id ? function_entries_.erase(it) : std::next(it);
+  }
+}
+
+static std::string GetMetadataKey(uint64_t function_start) {
+  return fmt::format("triton-bn.results.{:x}", function_start);
+}
+
+// FNV-1a hash of the bytes located in `ranges`. Returns false if some of them
+// can't be read.
+static bool HashContent(
+    BinaryView& view,
+    const std::vector<SimplificationCache::AddressRange>& ranges,
+    uint64_t& content_hash) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  std::vector<uint8_t> data{};
+  for (const auto& [range_start, range_end] : ranges) {
+    data.resize(range_end - range_start);
+    if (view.Read(data.data(), range_start, data.size()) != data.size()) {
+      return false;
+    }
+    for (const uint8_t byte : data) {
+      hash ^= byte;
+      hash *= 0x100000001b3ULL;
+    }
+  }
+
+  content_hash = hash;
+  return true;
+}
+
+}  // namespace triton_bn
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <binaryninjaapi.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <triton/basicBlock.hpp>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "core/simplification_cache.h"
+
+namespace triton_bn {
+
+// Keeps the results of previous simplifications of a view's `MetaBasicBlock`s,
+// so that re-running a command only recomputes the basic blocks that changed
+// in the meantime.
+// Results are marked dirty when the bytes they were computed from are written
+// to, or when the basic blocks they were extracted from are modified by the
+// analysis.
+// Results can be persisted in the view's metadata, one record per function, so
+// that they survive reopening the database. They're validated against the
+// current bytes when loaded back.
+class ViewSimplificationCache : public SimplificationCache,
+                                public BinaryNinja::BinaryDataNotification {
+ public:
+  // Get the cache associated with a given view, creating it if needed
+  static ViewSimplificationCache& ForView(BinaryNinja::BinaryView& view);
+  // Drop the cache associated with a given view, if any
+  static void ReleaseView(BinaryNinja::BinaryView* p_view);
+  // Persist the results of the cache associated with a given view, if any
+  static void PersistView(BinaryNinja::BinaryView& view);
+
+  // Load the results persisted for the function at `function_start`, keeping
+  // those whose input bytes haven't changed since.
+  // Note: Results are only loaded once per function, and never replace the
+  // ones computed since the view was opened
+  void LoadPersistedResults(BinaryNinja::BinaryView& view,
+                            uint64_t function_start);
+  // Store the results of the functions simplified since the last call in the
+  // view's metadata. Dirty results are left out.
+  void PersistResults(BinaryNinja::BinaryView& view);
+
+  bool Lookup(const Key& key, triton::arch::BasicBlock& simplified_bb) override;
+  void Store(const Key& key,
+             const triton::arch::BasicBlock& simplified_bb) override;
+
+  void OnBinaryDataWritten(BinaryNinja::BinaryView* p_view, uint64_t offset,
+                           size_t len) override;
+  void OnBinaryDataInserted(BinaryNinja::BinaryView* p_view, uint64_t offset,
+                            size_t len) override;
+  void OnBinaryDataRemoved(BinaryNinja::BinaryView* p_view, uint64_t offset,
+                           uint64_t len) override;
+  void OnAnalysisFunctionUpdated(BinaryNinja::BinaryView* p_view,
+                                 BinaryNinja::Function* p_function) override;
+
+ private:
+  // Note: Padded and unpadded results are stored separately
+  using EntryId = std::pair<uint64_t, bool>;
+  struct EntryIdHash {
+    size_t operator()(const EntryId& id) const {
+      return std::hash<uint64_t>()(id.first) ^ static_cast<size_t>(id.second);
+    }
+  };
+
+  struct Entry {
+    uint64_t fingerprint = 0;
+    uint64_t function_start = 0;
+    bool dirty = false;
+    std::vector<AddressRange> ranges{};
+    triton::arch::BasicBlock simplified_bb{};
+  };
+
+  void InsertEntry(const EntryId& id, Entry entry);
+  void MarkRangeDirty(uint64_t start, uint64_t end);
+  void RemoveFromIndexes(const EntryId& id, const Entry& entry);
+
+  std::mutex mutex_{};
+  std::unordered_map<EntryId, Entry, EntryIdHash> entries_{};
+  // Index used to find the entries affected by a write: range start ->
+  // (range end, entry)
+  std::multimap<uint64_t, std::pair<uint64_t, EntryId>> ranges_{};
+  uint64_t max_range_size_ = 0;
+  // Index used to find the entries affected by a function update
+  std::unordered_multimap<uint64_t, EntryId> function_entries_{};
+  // Functions whose persisted results have been loaded
+  std::unordered_set<uint64_t> loaded_functions_{};
+  // Functions with results that haven't been persisted yet
+  std::unordered_set<uint64_t> modified_functions_{};
+};
+
+}  // namespace triton_bn
@@ -0,0 +1,201 @@
+// Checks cross-basic block liveness and the dead store elimination pass that
+// relies on it, on small hand-assembled functions.
+
+#include <cstdint>
+#include <cstdio>
+#include <triton/context.hpp>
+#include <vector>
+
+#include "core/basic_block_simplifier.h"
+#include "core/cfg.h"
+#include "core/cfg_builder.h"
+#include "core/code_source.h"
+#include "core/liveness.h"
+#include "core/meta_basic_block.h"
+#include "test_helpers.h"
+
+using triton_bn::MetaBasicBlock;
+
+// Recover the CFG of the function in `code`, extract and merge its basic
+// blocks and compute their live-out registers, as the plugin does
+static std::vector<MetaBasicBlock> AnalyzeFunction(
+    triton::Context& triton, uint64_t function_start,
+    const std::vector<uint8_t>& code, triton_bn::ControlFlowGraph& cfg) {
+  triton_bn::MemoryCodeSource code_source{};
+  code_source.AddRange(function_start, code.data(), code.size());
+  cfg = triton_bn::RecoverControlFlowGraph(code_source, function_start, triton);
+  auto basic_blocks =
+      triton_bn::ExtractMetaBasicBlocksFromFunction(code_source, cfg, triton);
+  basic_blocks = triton_bn::MergeMetaBasicBlocks(cfg, std::move(basic_blocks));
+  triton_bn::ComputeLiveOutRegisters(triton, cfg, basic_blocks);
+  return basic_blocks;
+}
+
+static MetaBasicBlock* FindBasicBlock(std::vector<MetaBasicBlock>& basic_blocks,
+                                      uint64_t start) {
+  for (auto& meta_bb : basic_blocks) {
+    if (meta_bb.GetStart() == start) {
+      return &meta_bb;
+    }
+  }
+  return nullptr;
+}
+
+static bool IsLiveOut(const MetaBasicBlock* meta_bb,
+                      triton::arch::register_e reg) {
+  return meta_bb != nullptr && meta_bb->live_out().has_value() &&
+         meta_bb->live_out()->Contains(reg);
+}
+
+// Addresses of the instructions kept by `EliminateDeadStores`
+static std::vector<uint64_t> EliminateDeadStores(
+    const triton::Context& triton, MetaBasicBlock* meta_bb) {
+  std::vector<uint64_t> addresses{};
+  if (meta_bb == nullptr) {
+    return addresses;
+  }
+  const auto& live_out = meta_bb->live_out();
+  auto simplified_bb = triton_bn::EliminateDeadStores(
+      triton, meta_bb->triton_bb(), live_out ? &*live_out : nullptr, nullptr);
+  for (const auto& instr : simplified_bb.getInstructions()) {
+    addresses.push_back(instr.getAddress());
+  }
+  return addresses;
+}
+
+// Liveness relies on Triton reporting registers used to compute memory
+// addresses as read, even when they're only used as a base
+static void TestAddressRegistersAreRead() {
+  triton::Context triton(triton::arch::ARCH_X86_64);
+  // mov [rbx], eax
+  const uint8_t opcode[] = {0x89, 0x03};
+  triton::arch::Instruction instr(0x1000, opcode, sizeof(opcode));
+  CHECK(triton.processing(instr) == triton::arch::NO_FAULT);
+
+  bool rbx_read = false;
+  for (const auto& [reg, node] : instr.getReadRegisters()) {
+    rbx_read |=
+        triton.getParentRegister(reg).getId() == triton::arch::ID_REG_X86_RBX;
+  }
+  CHECK(rbx_read);
+}
+
+// Two paths that store through `rbx` and join into an exit basic block that
+// overwrites `rdx`
+static void TestX8664Branches() {
+  constexpr uint64_t kStart = 0x1000;
+  const std::vector<uint8_t> code = {
+      0x48, 0x89, 0xfb,                    // 0x1000: mov rbx, rdi
+      0xba, 0x02, 0x00, 0x00, 0x00,        // 0x1003: mov edx, 2
+      0xb9, 0x01, 0x00, 0x00, 0x00,        // 0x1008: mov ecx, 1
+      0x85, 0xff,                          // 0x100d: test edi, edi
+      0x74, 0x04,                          // 0x100f: je 0x1015
+      0x89, 0x03,                          // 0x1011: mov [rbx], eax
+      0xeb, 0x02,                          // 0x1013: jmp 0x1017
+      0x89, 0x0b,                          // 0x1015: mov [rbx], ecx
+      0xba, 0x00, 0x00, 0x00, 0x00,        // 0x1017: mov edx, 0
+      0xc3,                                // 0x101c: ret
+  };
+  triton::Context triton(triton::arch::ARCH_X86_64);
+  triton_bn::ControlFlowGraph cfg{};
+  auto basic_blocks = AnalyzeFunction(triton, kStart, code, cfg);
+  CHECK(cfg.block_count() == 4);
+
+  MetaBasicBlock* entry_bb = FindBasicBlock(basic_blocks, 0x1000);
+  CHECK(IsLiveOut(entry_bb, triton::arch::ID_REG_X86_RBX));
+  CHECK(IsLiveOut(entry_bb, triton::arch::ID_REG_X86_RAX));
+  CHECK(IsLiveOut(entry_bb, triton::arch::ID_REG_X86_RCX));
+  CHECK(!IsLiveOut(entry_bb, triton::arch::ID_REG_X86_RDX));
+  CHECK(!IsLiveOut(entry_bb, triton::arch::ID_REG_X86_ZF));
+  MetaBasicBlock* store_bb = FindBasicBlock(basic_blocks, 0x1011);
+  CHECK(!IsLiveOut(store_bb, triton::arch::ID_REG_X86_RBX));
+  CHECK(!IsLiveOut(store_bb, triton::arch::ID_REG_X86_RDX));
+  // Everything is live at the exit of the function
+  MetaBasicBlock* exit_bb = FindBasicBlock(basic_blocks, 0x1017);
+  CHECK(exit_bb != nullptr && !exit_bb->live_out().has_value());
+
+  // `rbx` is only read by successors as an address base, it must be kept
+  CHECK((EliminateDeadStores(triton, entry_bb) ==
+         std::vector<uint64_t>{0x1000, 0x1008, 0x100d, 0x100f}));
+  CHECK((EliminateDeadStores(triton, exit_bb) ==
+         std::vector<uint64_t>{0x1017, 0x101c}));
+}
+
+// A loop that accumulates into `eax`, followed by an exit basic block that
+// overwrites `esi`
+static void TestX8664Loop() {
+  constexpr uint64_t kStart = 0x2000;
+  const std::vector<uint8_t> code = {
+      0xb9, 0x0a, 0x00, 0x00, 0x00,  // 0x2000: mov ecx, 10
+      0xbe, 0x07, 0x00, 0x00, 0x00,  // 0x2005: mov esi, 7
+      0x01, 0xc8,                    // 0x200a: add eax, ecx
+      0xff, 0xc9,                    // 0x200c: dec ecx
+      0x75, 0xfa,                    // 0x200e: jne 0x200a
+      0xbe, 0x00, 0x00, 0x00, 0x00,  // 0x2010: mov esi, 0
+      0xc3,                          // 0x2015: ret
+  };
+  triton::Context triton(triton::arch::ARCH_X86_64);
+  triton_bn::ControlFlowGraph cfg{};
+  auto basic_blocks = AnalyzeFunction(triton, kStart, code, cfg);
+  CHECK(cfg.block_count() == 3);
+
+  // Live across the back edge
+  MetaBasicBlock* loop_bb = FindBasicBlock(basic_blocks, 0x200a);
+  CHECK(IsLiveOut(loop_bb, triton::arch::ID_REG_X86_RAX));
+  CHECK(IsLiveOut(loop_bb, triton::arch::ID_REG_X86_RCX));
+  CHECK(!IsLiveOut(loop_bb, triton::arch::ID_REG_X86_RSI));
+  MetaBasicBlock* entry_bb = FindBasicBlock(basic_blocks, 0x2000);
+  CHECK(IsLiveOut(entry_bb, triton::arch::ID_REG_X86_RAX));
+  CHECK(IsLiveOut(entry_bb, triton::arch::ID_REG_X86_RCX));
+  CHECK(!IsLiveOut(entry_bb, triton::arch::ID_REG_X86_RSI));
+
+  CHECK((EliminateDeadStores(triton, entry_bb) ==
+         std::vector<uint64_t>{0x2000}));
+  CHECK((EliminateDeadStores(triton, loop_bb) ==
+         std::vector<uint64_t>{0x200a, 0x200c, 0x200e}));
+}
+
+// Same shape as `TestX8664Branches`, `x3` is only used as an address base
+static void TestAarch64Branches() {
+  constexpr uint64_t kStart = 0x4000;
+  const std::vector<uint8_t> code = {
+      0x21, 0x00, 0x80, 0xd2,  // 0x4000: mov x1, #1
+      0x42, 0x00, 0x80, 0xd2,  // 0x4004: mov x2, #2
+      0x60, 0x00, 0x00, 0xb4,  // 0x4008: cbz x0, #0x4014
+      0x61, 0x00, 0x00, 0xf9,  // 0x400c: str x1, [x3]
+      0x02, 0x00, 0x00, 0x14,  // 0x4010: b #0x4018
+      0xa1, 0x00, 0x80, 0xd2,  // 0x4014: mov x1, #5
+      0x02, 0x00, 0x80, 0xd2,  // 0x4018: mov x2, #0
+      0xc0, 0x03, 0x5f, 0xd6,  // 0x401c: ret
+  };
+  triton::Context triton(triton::arch::ARCH_AARCH64);
+  triton_bn::ControlFlowGraph cfg{};
+  auto basic_blocks = AnalyzeFunction(triton, kStart, code, cfg);
+  CHECK(cfg.block_count() == 4);
+
+  MetaBasicBlock* entry_bb = FindBasicBlock(basic_blocks, 0x4000);
+  CHECK(IsLiveOut(entry_bb, triton::arch::ID_REG_AARCH64_X1));
+  CHECK(IsLiveOut(entry_bb, triton::arch::ID_REG_AARCH64_X3));
+  CHECK(!IsLiveOut(entry_bb, triton::arch::ID_REG_AARCH64_X2));
+  MetaBasicBlock* store_bb = FindBasicBlock(basic_blocks, 0x400c);
+  CHECK(!IsLiveOut(store_bb, triton::arch::ID_REG_AARCH64_X1));
+  CHECK(!IsLiveOut(store_bb, triton::arch::ID_REG_AARCH64_X2));
+  MetaBasicBlock* exit_bb = FindBasicBlock(basic_blocks, 0x4018);
+  CHECK(exit_bb != nullptr && !exit_bb->live_out().has_value());
+
+  CHECK((EliminateDeadStores(triton, entry_bb) ==
+         std::vector<uint64_t>{0x4000, 0x4008}));
+  CHECK((EliminateDeadStores(triton, exit_bb) ==
+         std::vector<uint64_t>{0x4018, 0x401c}));
+}
+
+int main(int argc, char* argv[]) {
+  std::printf("LivenessTest\n");
+
+  TestAddressRegistersAreRead();
+  TestX8664Branches();
+  TestX8664Loop();
+  TestAarch64Branches();
+
+  return ReportCheckResults();
+}
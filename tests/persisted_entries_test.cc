@@ -0,0 +1,110 @@
+// Checks that simplification results persisted in a database's metadata are
+// read back as they were written, and that corrupted records are rejected.
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "core/persisted_entries.h"
+#include "test_helpers.h"
+
+using triton_bn::PersistedEntry;
+
+static bool IsSameEntry(const PersistedEntry& lhs, const PersistedEntry& rhs) {
+  return lhs.start == rhs.start && lhs.padding == rhs.padding &&
+         lhs.fingerprint == rhs.fingerprint &&
+         lhs.content_hash == rhs.content_hash && lhs.ranges == rhs.ranges &&
+         lhs.opcodes == rhs.opcodes;
+}
+
+// Entries covering what the encoding special-cases: addresses going down
+// (negative deltas), values using all 64 bits, several ranges and no
+// instructions at all
+static std::vector<PersistedEntry> MakeEntries() {
+  std::vector<PersistedEntry> entries(3);
+  entries[0].start = 0x140001000;
+  entries[0].padding = true;
+  entries[0].fingerprint = UINT64_MAX;
+  entries[0].content_hash = 0x8000000000000000ULL;
+  entries[0].ranges = {{0x140001000, 0x140001010}, {0x140002000, 0x140002004}};
+  entries[0].opcodes = {{0x90}, {0x48, 0x89, 0xfb}, {0xc3}};
+
+  entries[1].start = 0x1000;
+  entries[1].fingerprint = 1;
+  entries[1].content_hash = 0;
+  entries[1].ranges = {{0x1000, 0x1001}};
+
+  entries[2].start = 0xfffffffffffff000ULL;
+  entries[2].fingerprint = 0x7f;
+  entries[2].content_hash = 0x80;
+  entries[2].ranges = {{0xfffffffffffff000ULL, 0xfffffffffffff004ULL}};
+  entries[2].opcodes = {{0xc0, 0x03, 0x5f, 0xd6}};
+  return entries;
+}
+
+static void TestRoundTrip() {
+  const std::vector<PersistedEntry> entries = MakeEntries();
+  const auto data = triton_bn::SerializePersistedEntries(entries);
+
+  std::vector<PersistedEntry> read_entries{};
+  CHECK(triton_bn::DeserializePersistedEntries(data, read_entries));
+  CHECK(read_entries.size() == entries.size());
+  for (size_t i = 0; i < entries.size() && i < read_entries.size(); i++) {
+    CHECK(IsSameEntry(entries[i], read_entries[i]));
+  }
+
+  std::vector<PersistedEntry> no_entries{};
+  CHECK(triton_bn::DeserializePersistedEntries(
+      triton_bn::SerializePersistedEntries({}), no_entries));
+  CHECK(no_entries.empty());
+}
+
+static void TestCorruptedRecords() {
+  const auto data = triton_bn::SerializePersistedEntries(MakeEntries());
+  std::vector<PersistedEntry> entries{};
+
+  CHECK(!triton_bn::DeserializePersistedEntries({}, entries));
+  // Another version
+  auto other_version = data;
+  other_version[0]++;
+  CHECK(!triton_bn::DeserializePersistedEntries(other_version, entries));
+  // Truncated anywhere
+  for (size_t size = 1; size < data.size(); size++) {
+    entries.clear();
+    const std::vector<uint8_t> truncated(std::begin(data),
+                                         std::begin(data) + size);
+    CHECK(!triton_bn::DeserializePersistedEntries(truncated, entries));
+  }
+  // Trailing data
+  auto trailing = data;
+  trailing.push_back(0);
+  CHECK(!triton_bn::DeserializePersistedEntries(trailing, entries));
+
+  // Counts bigger than the record, which mustn't be allocated
+  entries.clear();
+  const std::vector<uint8_t> huge_count = {data[0], 0xff, 0xff, 0xff,
+                                           0xff,    0xff, 0x0f};
+  CHECK(!triton_bn::DeserializePersistedEntries(huge_count, entries));
+  CHECK(entries.empty());
+  // Integers that don't fit in 64 bits
+  std::vector<uint8_t> overlong = {data[0]};
+  overlong.insert(std::end(overlong), 11, 0xff);
+  overlong.push_back(0x01);
+  CHECK(!triton_bn::DeserializePersistedEntries(overlong, entries));
+
+  // Ranges that can't come from a basic block
+  std::vector<PersistedEntry> huge_range_entries(1);
+  huge_range_entries[0].start = 0x1000;
+  huge_range_entries[0].ranges = {{0x1000, 0x1000 + (uint64_t{1} << 32)}};
+  CHECK(!triton_bn::DeserializePersistedEntries(
+      triton_bn::SerializePersistedEntries(huge_range_entries), entries));
+}
+
+int main(int argc, char* argv[]) {
+  std::printf("PersistedEntriesTest\n");
+
+  TestRoundTrip();
+  TestCorruptedRecords();
+
+  return ReportCheckResults();
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdio>
+
+// Number of `CHECK`s that failed so far
+inline int failure_count = 0;
+
+// Report `COND` if it doesn't hold, and keep going with the test
+#define CHECK(COND)                                                  \
+  do {                                                               \
+    if (!(COND)) {                                                   \
+      std::fprintf(stderr, "%s:%d: Check failed: %s\n", __FILE__,    \
+                   __LINE__, #COND);                                 \
+      failure_count++;                                               \
+    }                                                                \
+  } while (false)
+
+// Print the outcome of the checks, to be returned from `main`
+inline int ReportCheckResults() {
+  if (failure_count > 0) {
+    std::printf("%d check(s) failed\n", failure_count);
+    return 1;
+  }
+  std::printf("All checks passed\n");
+  return 0;
+}
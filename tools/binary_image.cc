@@ -0,0 +1,179 @@
+#include "binary_image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace triton_bn {
+
+// Subset of the ELF specification needed to locate loadable segments
+constexpr uint8_t kElfMagic[] = {0x7f, 'E', 'L', 'F'};
+constexpr uint8_t kElfClass32 = 1;
+constexpr uint8_t kElfClass64 = 2;
+constexpr uint8_t kElfDataLittleEndian = 1;
+constexpr uint16_t kElfMachineX86 = 3;
+constexpr uint16_t kElfMachineX86_64 = 62;
+constexpr uint16_t kElfMachineAArch64 = 183;
+constexpr uint32_t kElfSegmentLoad = 1;
+
+template <typename T>
+static bool ReadValue(const uint8_t* data, size_t size, uint64_t offset,
+                      T& value);
+
+bool BinaryImage::LoadElf(const uint8_t* data, size_t size,
+                          std::string& error) {
+  *this = {};
+
+  if (size < 16 || std::memcmp(data, kElfMagic, sizeof(kElfMagic)) != 0) {
+    error = "not an ELF file";
+    return false;
+  }
+  const uint8_t elf_class = data[4];
+  if (elf_class != kElfClass32 && elf_class != kElfClass64) {
+    error = "unsupported ELF class";
+    return false;
+  }
+  if (data[5] != kElfDataLittleEndian) {
+    error = "only little-endian ELF files are supported";
+    return false;
+  }
+  const bool is_64_bit = elf_class == kElfClass64;
+
+  // Note: Fields that differ in size between 32 and 64-bit files are read
+  // through the right type and widened
+  uint16_t machine = 0;
+  uint64_t program_headers_offset = 0;
+  uint16_t program_header_size = 0;
+  uint16_t program_header_count = 0;
+  bool valid = ReadValue(data, size, 0x12, machine);
+  if (is_64_bit) {
+    valid = valid && ReadValue(data, size, 0x18, entry_point_) &&
+            ReadValue(data, size, 0x20, program_headers_offset) &&
+            ReadValue(data, size, 0x36, program_header_size) &&
+            ReadValue(data, size, 0x38, program_header_count);
+  } else {
+    uint32_t entry_point = 0;
+    uint32_t offset = 0;
+    valid = valid && ReadValue(data, size, 0x18, entry_point) &&
+            ReadValue(data, size, 0x1c, offset) &&
+            ReadValue(data, size, 0x2a, program_header_size) &&
+            ReadValue(data, size, 0x2c, program_header_count);
+    entry_point_ = entry_point;
+    program_headers_offset = offset;
+  }
+  if (!valid) {
+    error = "truncated ELF header";
+    return false;
+  }
+
+  switch (machine) {
+    case kElfMachineX86:
+      architecture_ = triton::arch::ARCH_X86;
+      break;
+    case kElfMachineX86_64:
+      architecture_ = triton::arch::ARCH_X86_64;
+      break;
+    case kElfMachineAArch64:
+      architecture_ = triton::arch::ARCH_AARCH64;
+      break;
+    default:
+      error = "unsupported ELF machine " + std::to_string(machine);
+      return false;
+  }
+
+  for (uint16_t i = 0; i < program_header_count; i++) {
+    const uint64_t header_offset =
+        program_headers_offset + uint64_t{i} * program_header_size;
+    uint32_t type = 0;
+    ImageSegment segment{};
+    uint64_t file_size = 0;
+    if (is_64_bit) {
+      valid = ReadValue(data, size, header_offset, type) &&
+              ReadValue(data, size, header_offset + 0x08,
+                        segment.file_offset) &&
+              ReadValue(data, size, header_offset + 0x10, segment.address) &&
+              ReadValue(data, size, header_offset + 0x20, file_size);
+    } else {
+      uint32_t offset = 0;
+      uint32_t address = 0;
+      uint32_t size_32 = 0;
+      valid = ReadValue(data, size, header_offset, type) &&
+              ReadValue(data, size, header_offset + 0x04, offset) &&
+              ReadValue(data, size, header_offset + 0x08, address) &&
+              ReadValue(data, size, header_offset + 0x10, size_32);
+      segment.file_offset = offset;
+      segment.address = address;
+      file_size = size_32;
+    }
+    if (!valid) {
+      error = "truncated program header table";
+      return false;
+    }
+    if (type != kElfSegmentLoad || file_size == 0) {
+      continue;
+    }
+    if (segment.file_offset > size || file_size > size - segment.file_offset) {
+      error = "segment " + std::to_string(i) + " exceeds the file's size";
+      return false;
+    }
+    segment.size = static_cast<size_t>(file_size);
+    AddSegment(data, segment);
+  }
+  if (segments_.empty()) {
+    error = "no loadable segment";
+    return false;
+  }
+
+  return true;
+}
+
+void BinaryImage::LoadRaw(const uint8_t* data, size_t size,
+                          uint64_t base_address,
+                          triton::arch::architecture_e architecture) {
+  *this = {};
+  architecture_ = architecture;
+  entry_point_ = base_address;
+
+  ImageSegment segment{};
+  segment.address = base_address;
+  segment.file_offset = 0;
+  segment.size = size;
+  AddSegment(data, segment);
+}
+
+bool BinaryImage::AddressToFileOffset(uint64_t address, size_t size,
+                                      uint64_t& file_offset) const {
+  for (const ImageSegment& segment : segments_) {
+    if (address >= segment.address &&
+        address - segment.address <= segment.size &&
+        size <= segment.size - (address - segment.address)) {
+      file_offset = segment.file_offset + (address - segment.address);
+      return true;
+    }
+  }
+  return false;
+}
+
+void BinaryImage::AddSegment(const uint8_t* data, const ImageSegment& segment) {
+  // Note: Segments are kept sorted by address
+  const auto it = std::upper_bound(
+      std::begin(segments_), std::end(segments_), segment.address,
+      [](uint64_t address, const ImageSegment& segment) {
+        return address < segment.address;
+      });
+  segments_.insert(it, segment);
+  code_.AddRange(segment.address, data + segment.file_offset, segment.size);
+}
+
+// Note: Only valid on little-endian hosts, like the files themselves
+template <typename T>
+static bool ReadValue(const uint8_t* data, size_t size, uint64_t offset,
+                      T& value) {
+  if (offset > size || sizeof(T) > size - offset) {
+    return false;
+  }
+  std::memcpy(&value, data + offset, sizeof(T));
+  return true;
+}
+
+}  // namespace triton_bn
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <triton/archEnums.hpp>
+#include <vector>
+
+#include "core/code_source.h"
+
+namespace triton_bn {
+
+// Part of the file that's mapped at a given address
+struct ImageSegment {
+  uint64_t address = 0;
+  uint64_t file_offset = 0;
+  size_t size = 0;
+};
+
+// Layout of an executable image backed by a memory-mapped file. Only the
+// segments' file-backed content is taken into account.
+class BinaryImage {
+ public:
+  // Parse the program headers of a little-endian ELF file (32 or 64-bit)
+  bool LoadElf(const uint8_t* data, size_t size, std::string& error);
+  // Map a raw blob of code at `base_address`
+  void LoadRaw(const uint8_t* data, size_t size, uint64_t base_address,
+               triton::arch::architecture_e architecture);
+
+  triton::arch::architecture_e architecture() const { return architecture_; }
+  void set_architecture(triton::arch::architecture_e architecture) {
+    architecture_ = architecture;
+  }
+  uint64_t entry_point() const { return entry_point_; }
+  const std::vector<ImageSegment>& segments() const { return segments_; }
+  const MemoryCodeSource& code() const { return code_; }
+
+  // Translate the range [address, address + size) into a file offset. Fails if
+  // the range isn't entirely backed by a single segment.
+  bool AddressToFileOffset(uint64_t address, size_t size,
+                           uint64_t& file_offset) const;
+
+ private:
+  void AddSegment(const uint8_t* data, const ImageSegment& segment);
+
+  triton::arch::architecture_e architecture_ = triton::arch::ARCH_INVALID;
+  uint64_t entry_point_ = 0;
+  std::vector<ImageSegment> segments_{};
+  MemoryCodeSource code_{};
+};
+
+}  // namespace triton_bn
@@ -0,0 +1,136 @@
+#include "cfg_json.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace triton_bn {
+
+using json = nlohmann::json;
+
+static ControlFlowGraph ParseFunction(const json& function);
+static uint64_t ParseAddress(const json& value);
+static BranchType ParseBranchType(const std::string& name);
+
+bool LoadCfgsFromJson(const std::string& path,
+                      std::vector<ControlFlowGraph>& cfgs,
+                      std::string& error) {
+  std::ifstream input(path);
+  if (!input) {
+    error = "failed to open '" + path + "'";
+    return false;
+  }
+
+  try {
+    const json document = json::parse(input);
+    for (const json& function : document.at("functions")) {
+      cfgs.emplace_back(ParseFunction(function));
+    }
+  } catch (std::exception& ex) {
+    error = "invalid CFG file '" + path + "': " + ex.what();
+    return false;
+  }
+
+  return true;
+}
+
+static ControlFlowGraph ParseFunction(const json& function) {
+  ControlFlowGraph cfg{};
+  cfg.function_start = ParseAddress(function.at("start"));
+
+  // Note: Basic blocks are indexed first, so that edges can be resolved while
+  // the graph is built
+  const json& basic_blocks = function.at("basic_blocks");
+  // Start address -> CFG index
+  std::unordered_map<uint64_t, uint32_t> cfg_indexes{};
+  for (const json& basic_block : basic_blocks) {
+    cfg_indexes.emplace(ParseAddress(basic_block.at("start")),
+                        static_cast<uint32_t>(cfg_indexes.size()));
+  }
+  if (cfg_indexes.size() != basic_blocks.size()) {
+    throw std::invalid_argument("basic blocks must have distinct addresses");
+  }
+
+  for (const json& basic_block : basic_blocks) {
+    const uint64_t start = ParseAddress(basic_block.at("start"));
+    const uint64_t end = ParseAddress(basic_block.at("end"));
+    if (end < start) {
+      throw std::invalid_argument("basic block ends before its start");
+    }
+    cfg.AddBasicBlock(start, end);
+
+    const auto edges = basic_block.find("edges");
+    if (edges == std::cend(basic_block)) {
+      continue;
+    }
+    for (const json& edge : *edges) {
+      uint32_t target = kInvalidBlockIndex;
+      const auto target_it = edge.find("target");
+      if (target_it != std::cend(edge)) {
+        const auto it = cfg_indexes.find(ParseAddress(*target_it));
+        if (it != std::cend(cfg_indexes)) {
+          target = it->second;
+        }
+      }
+      cfg.AddOutgoingEdge(ParseBranchType(edge.at("type").get<std::string>()),
+                          target);
+    }
+  }
+  CountIncomingEdges(cfg);
+
+  return cfg;
+}
+
+static uint64_t ParseAddress(const json& value) {
+  if (value.is_number_unsigned()) {
+    return value.get<uint64_t>();
+  }
+
+  const std::string str = value.get<std::string>();
+  char* end = nullptr;
+  const uint64_t address = std::strtoull(str.c_str(), &end, 0);
+  if (str.empty() || *end != '\0') {
+    throw std::invalid_argument("invalid address '" + str + "'");
+  }
+  return address;
+}
+
+static BranchType ParseBranchType(const std::string& name) {
+  if (name == "unconditional") {
+    return BranchType::kUnconditional;
+  }
+  if (name == "false") {
+    return BranchType::kFalse;
+  }
+  if (name == "true") {
+    return BranchType::kTrue;
+  }
+  if (name == "call") {
+    return BranchType::kCall;
+  }
+  if (name == "return") {
+    return BranchType::kReturn;
+  }
+  if (name == "system_call") {
+    return BranchType::kSystemCall;
+  }
+  if (name == "indirect") {
+    return BranchType::kIndirect;
+  }
+  if (name == "exception") {
+    return BranchType::kException;
+  }
+  if (name == "user_defined") {
+    return BranchType::kUserDefined;
+  }
+  if (name == "unresolved") {
+    return BranchType::kUnresolved;
+  }
+
+  throw std::invalid_argument("unknown edge type '" + name + "'");
+}
+
+}  // namespace triton_bn
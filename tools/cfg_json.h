@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "core/cfg.h"
+
+namespace triton_bn {
+
+// Load control flow graphs exported by another tool. The expected layout is:
+//
+//   {"functions": [{"start": 4198400,
+//                   "basic_blocks": [{"start": 4198400, "end": 4198410,
+//                                     "edges": [{"type": "true",
+//                                                "target": 4198420}]}]}]}
+//
+// Addresses can also be given as strings (e.g., "0x401000"). Edge types are
+// named after `BranchType` (e.g., "unconditional", "false", "call") and edges
+// whose target isn't one of the function's basic blocks are kept untargeted.
+bool LoadCfgsFromJson(const std::string& path,
+                      std::vector<ControlFlowGraph>& cfgs, std::string& error);
+
+}  // namespace triton_bn
@@ -0,0 +1,130 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace triton_bn {
+
+MappedFile::~MappedFile() { Close(); }
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path, std::string& error) {
+  Close();
+
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    error = "failed to open '" + path + "'";
+    return false;
+  }
+  file_handle_ = file;
+
+  LARGE_INTEGER file_size{};
+  if (!GetFileSizeEx(file, &file_size)) {
+    error = "failed to get the size of '" + path + "'";
+    Close();
+    return false;
+  }
+  size_ = static_cast<size_t>(file_size.QuadPart);
+  if (size_ == 0) {
+    // Note: Empty files can't be mapped
+    return true;
+  }
+
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    error = "failed to map '" + path + "'";
+    Close();
+    return false;
+  }
+  mapping_handle_ = mapping;
+
+  data_ = static_cast<const uint8_t*>(
+      MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (data_ == nullptr) {
+    error = "failed to map '" + path + "'";
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_handle_ != nullptr) {
+    CloseHandle(mapping_handle_);
+  }
+  if (file_handle_ != nullptr) {
+    CloseHandle(file_handle_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  mapping_handle_ = nullptr;
+  file_handle_ = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path, std::string& error) {
+  Close();
+
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    error = "failed to open '" + path + "': " + std::strerror(errno);
+    return false;
+  }
+
+  struct stat file_stat {};
+  if (fstat(fd, &file_stat) != 0) {
+    error = "failed to stat '" + path + "': " + std::strerror(errno);
+    close(fd);
+    return false;
+  }
+  size_ = static_cast<size_t>(file_stat.st_size);
+  if (size_ == 0) {
+    // Note: Empty files can't be mapped
+    close(fd);
+    return true;
+  }
+
+  void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  // Note: The mapping stays valid once the descriptor is closed
+  close(fd);
+  if (data == MAP_FAILED) {
+    error = "failed to map '" + path + "': " + std::strerror(errno);
+    size_ = 0;
+    return false;
+  }
+  data_ = static_cast<const uint8_t*>(data);
+
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<uint8_t*>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+#endif
+
+}  // namespace triton_bn
@@ -0,0 +1,527 @@
+// Standalone front-end of the simplification pipeline, meant for batch
+// processing without "Binary Ninja".
+//
+// Usage: triton_bn_cli --input <file> [options]
+//
+// The input file (ELF or raw blob) is memory-mapped, the selected functions and
+// basic blocks are simplified in parallel and the patched image is written to a
+// new file. A JSON results file describes what has been done.
+// Functions' CFGs are either read from a JSON file or recovered from the code.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "binary_image.h"
+#include "cfg_json.h"
+#include "core/arch_traits.h"
+#include "core/ast_memory_governor.h"
+#include "core/instrumentation.h"
+#include "core/meta_basic_block.h"
+#include "core/patch_builder.h"
+#include "core/simplification_pipeline.h"
+#include "mapped_file.h"
+
+using json = nlohmann::json;
+
+// Version of the results file's layout
+constexpr int kResultSchemaVersion = 1;
+
+struct BlockRange {
+  uint64_t start = 0;
+  uint64_t end = 0;
+};
+
+struct CliOptions {
+  std::string input_path{};
+  std::string output_path{};
+  std::string results_path{};
+  std::string cfg_path{};
+  // Empty means "guess from the input"
+  std::string architecture_name{};
+  bool raw = false;
+  uint64_t base_address = 0;
+  std::vector<uint64_t> function_addresses{};
+  std::vector<BlockRange> block_ranges{};
+  // 0 means one worker per hardware thread
+  size_t worker_count = 0;
+  bool merge_basic_blocks = true;
+  bool cross_block_liveness = true;
+  size_t max_rounds = 1;
+  triton_bn::SimplificationBudget budget{};
+  // Ceiling of the memory held by symbolic state, 0 means none
+  uint64_t memory_ceiling_mib = 0;
+  bool instrumentation = false;
+};
+
+struct FunctionResult {
+  size_t basic_block_count = 0;
+  size_t instruction_count_in = 0;
+  size_t instruction_count_out = 0;
+  // Basic blocks that ran out of simplification budget
+  std::vector<uint64_t> over_budget_blocks{};
+  bool simplified = false;
+};
+
+static bool ParseArguments(int argc, char* argv[], CliOptions& options);
+static void PrintUsage(const char* program_name);
+static bool ParseAddress(const char* str, uint64_t& address);
+static bool ParseBlockRange(const char* str, BlockRange& range);
+static bool LoadImage(const CliOptions& options,
+                      const triton_bn::MappedFile& file,
+                      triton_bn::BinaryImage& image);
+static bool CollectCfgs(const CliOptions& options,
+                        std::vector<triton_bn::ControlFlowGraph>& cfgs);
+static std::vector<std::vector<triton_bn::MetaBasicBlock>> SimplifyFunctions(
+    const CliOptions& options, const triton_bn::BinaryImage& image,
+    std::vector<triton_bn::ControlFlowGraph>& cfgs,
+    std::vector<FunctionResult>& results);
+static bool WritePatchedImage(const CliOptions& options,
+                              const triton_bn::BinaryImage& image,
+                              const std::vector<triton_bn::Patch>& patches);
+static bool WriteResults(const CliOptions& options,
+                         const triton_bn::BinaryImage& image,
+                         const std::vector<triton_bn::ControlFlowGraph>& cfgs,
+                         const std::vector<FunctionResult>& results,
+                         const triton_bn::PatchStatistics& patch_statistics);
+
+int main(int argc, char* argv[]) {
+  CliOptions options{};
+  if (!ParseArguments(argc, argv, options)) {
+    PrintUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  triton_bn::MappedFile file{};
+  std::string error{};
+  if (!file.Open(options.input_path, error)) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return EXIT_FAILURE;
+  }
+  triton_bn::BinaryImage image{};
+  if (!LoadImage(options, file, image)) {
+    return EXIT_FAILURE;
+  }
+
+  std::vector<triton_bn::ControlFlowGraph> cfgs{};
+  if (!CollectCfgs(options, cfgs)) {
+    return EXIT_FAILURE;
+  }
+
+  triton_bn::Instrumentation::Instance().SetEnabled(options.instrumentation);
+
+  std::vector<FunctionResult> results{};
+  auto simplified_functions =
+      SimplifyFunctions(options, image, cfgs, results);
+
+  // Note: All patches are computed at once so that overlapping functions are
+  // handled consistently
+  std::vector<triton_bn::MetaBasicBlock> simplified_basic_blocks{};
+  for (auto& function_basic_blocks : simplified_functions) {
+    std::move(std::begin(function_basic_blocks),
+              std::end(function_basic_blocks),
+              std::back_inserter(simplified_basic_blocks));
+  }
+  triton_bn::PatchStatistics patch_statistics{};
+  std::vector<triton_bn::Patch> patches{};
+  {
+    triton_bn::ScopedStageTimer timer(triton_bn::Stage::kPatching);
+    patches = triton_bn::BuildPatches(image.code(), simplified_basic_blocks,
+                                      patch_statistics);
+  }
+
+  bool success = true;
+  if (!options.output_path.empty()) {
+    success &= WritePatchedImage(options, image, patches);
+  }
+  if (!options.results_path.empty()) {
+    success &= WriteResults(options, image, cfgs, results, patch_statistics);
+  }
+
+  const size_t failed_count =
+      std::count_if(std::cbegin(results), std::cend(results),
+                    [](const FunctionResult& result) {
+                      return !result.simplified;
+                    });
+  std::printf(
+      "%zu function(s) simplified, %zu failed, %zu byte(s) patched in %zu "
+      "write(s)\n",
+      results.size() - failed_count, failed_count,
+      patch_statistics.changed_byte_count, patch_statistics.write_count);
+
+  return success && failed_count == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool ParseArguments(int argc, char* argv[], CliOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (std::strcmp(arg, "--input") == 0 && has_value) {
+      options.input_path = argv[++i];
+    } else if (std::strcmp(arg, "--output") == 0 && has_value) {
+      options.output_path = argv[++i];
+    } else if (std::strcmp(arg, "--results") == 0 && has_value) {
+      options.results_path = argv[++i];
+    } else if (std::strcmp(arg, "--cfg") == 0 && has_value) {
+      options.cfg_path = argv[++i];
+    } else if (std::strcmp(arg, "--arch") == 0 && has_value) {
+      options.architecture_name = argv[++i];
+    } else if (std::strcmp(arg, "--raw") == 0) {
+      options.raw = true;
+    } else if (std::strcmp(arg, "--base") == 0 && has_value) {
+      if (!ParseAddress(argv[++i], options.base_address)) {
+        return false;
+      }
+    } else if (std::strcmp(arg, "--function") == 0 && has_value) {
+      uint64_t address = 0;
+      if (!ParseAddress(argv[++i], address)) {
+        return false;
+      }
+      options.function_addresses.push_back(address);
+    } else if (std::strcmp(arg, "--block") == 0 && has_value) {
+      BlockRange range{};
+      if (!ParseBlockRange(argv[++i], range)) {
+        return false;
+      }
+      options.block_ranges.push_back(range);
+    } else if (std::strcmp(arg, "--jobs") == 0 && has_value) {
+      options.worker_count = std::strtoul(argv[++i], nullptr, 0);
+    } else if (std::strcmp(arg, "--no-merge") == 0) {
+      options.merge_basic_blocks = false;
+    } else if (std::strcmp(arg, "--no-liveness") == 0) {
+      options.cross_block_liveness = false;
+    } else if (std::strcmp(arg, "--rounds") == 0 && has_value) {
+      options.max_rounds = std::strtoul(argv[++i], nullptr, 0);
+      if (options.max_rounds == 0) {
+        return false;
+      }
+    } else if (std::strcmp(arg, "--block-time-budget") == 0 && has_value) {
+      options.budget.time_limit_ms = std::strtoull(argv[++i], nullptr, 0);
+    } else if (std::strcmp(arg, "--block-ast-budget") == 0 && has_value) {
+      options.budget.ast_node_limit = std::strtoull(argv[++i], nullptr, 0);
+    } else if (std::strcmp(arg, "--budget-fallback") == 0 && has_value) {
+      const char* fallback = argv[++i];
+      if (std::strcmp(fallback, "nop") == 0) {
+        options.budget.fallback = triton_bn::BudgetFallback::kNopLikeRemoval;
+      } else if (std::strcmp(fallback, "unchanged") == 0) {
+        options.budget.fallback = triton_bn::BudgetFallback::kUnchanged;
+      } else {
+        return false;
+      }
+    } else if (std::strcmp(arg, "--memory-ceiling") == 0 && has_value) {
+      options.memory_ceiling_mib = std::strtoull(argv[++i], nullptr, 0);
+    } else if (std::strcmp(arg, "--instrumentation") == 0) {
+      options.instrumentation = true;
+    } else {
+      return false;
+    }
+  }
+
+  return !options.input_path.empty();
+}
+
+static void PrintUsage(const char* program_name) {
+  std::fprintf(
+      stderr,
+      "Usage: %s --input <file> [options]\n"
+      "\n"
+      "Input:\n"
+      "  --raw                 Treat the input as a raw blob of code\n"
+      "  --arch <name>         Architecture (x86, x86_64 or aarch64),\n"
+      "                        required for raw blobs\n"
+      "  --base <address>      Address at which a raw blob is mapped\n"
+      "  --cfg <path>          JSON file describing the functions' CFGs\n"
+      "  --function <address>  Simplify this function, its CFG is recovered\n"
+      "                        from the code unless it's part of the CFG file\n"
+      "                        (can be repeated)\n"
+      "  --block <start>:<end> Simplify this basic block (can be repeated)\n"
+      "\n"
+      "Output:\n"
+      "  --output <path>       Write the patched image to this file\n"
+      "  --results <path>      Write the results as JSON to this file\n"
+      "\n"
+      "Simplification:\n"
+      "  --jobs <n>            Number of worker threads (default: one per\n"
+      "                        hardware thread)\n"
+      "  --no-merge            Don't merge linked basic blocks\n"
+      "  --no-liveness         Consider every register live at the end of\n"
+      "                        basic blocks\n"
+      "  --rounds <n>          Repeat the simplification passes until basic\n"
+      "                        blocks stop changing, at most n times\n"
+      "                        (default: 1)\n"
+      "  --block-time-budget <ms>\n"
+      "                        Time limit of the dead store elimination of\n"
+      "                        each basic block (default: none)\n"
+      "  --block-ast-budget <n>\n"
+      "                        Limit on the AST nodes built for each basic\n"
+      "                        block (default: none)\n"
+      "  --budget-fallback <nop|unchanged>\n"
+      "                        What's left of over-budget basic blocks: only\n"
+      "                        NOP-like instructions removed (default) or\n"
+      "                        nothing changed\n"
+      "  --memory-ceiling <MiB>\n"
+      "                        Bound the memory held by symbolic state\n"
+      "                        (default: none)\n"
+      "  --instrumentation     Include per-stage timings in the results\n",
+      program_name);
+}
+
+static bool ParseAddress(const char* str, uint64_t& address) {
+  char* end = nullptr;
+  address = std::strtoull(str, &end, 0);
+  return end != str && *end == '\0';
+}
+
+// Format: <start>:<end>
+static bool ParseBlockRange(const char* str, BlockRange& range) {
+  const char* separator = std::strchr(str, ':');
+  if (separator == nullptr) {
+    return false;
+  }
+
+  const std::string start(str, separator);
+  return ParseAddress(start.c_str(), range.start) &&
+         ParseAddress(separator + 1, range.end) && range.start < range.end;
+}
+
+static bool LoadImage(const CliOptions& options,
+                      const triton_bn::MappedFile& file,
+                      triton_bn::BinaryImage& image) {
+  triton::arch::architecture_e architecture = triton::arch::ARCH_INVALID;
+  if (!options.architecture_name.empty()) {
+    architecture = triton_bn::ArchitectureFromName(options.architecture_name);
+    if (architecture == triton::arch::ARCH_INVALID) {
+      std::fprintf(stderr, "Unsupported architecture '%s'\n",
+                   options.architecture_name.c_str());
+      return false;
+    }
+  }
+
+  if (options.raw) {
+    if (architecture == triton::arch::ARCH_INVALID) {
+      std::fprintf(stderr, "The architecture of raw blobs must be given\n");
+      return false;
+    }
+    image.LoadRaw(file.data(), file.size(), options.base_address,
+                  architecture);
+    return true;
+  }
+
+  std::string error{};
+  if (!image.LoadElf(file.data(), file.size(), error)) {
+    std::fprintf(stderr, "Failed to load '%s': %s (use --raw for raw blobs)\n",
+                 options.input_path.c_str(), error.c_str());
+    return false;
+  }
+  if (architecture != triton::arch::ARCH_INVALID) {
+    image.set_architecture(architecture);
+  }
+
+  return true;
+}
+
+// Gather the CFGs of the functions and basic blocks to simplify
+static bool CollectCfgs(const CliOptions& options,
+                        std::vector<triton_bn::ControlFlowGraph>& cfgs) {
+  if (!options.cfg_path.empty()) {
+    std::vector<triton_bn::ControlFlowGraph> file_cfgs{};
+    std::string error{};
+    if (!triton_bn::LoadCfgsFromJson(options.cfg_path, file_cfgs, error)) {
+      std::fprintf(stderr, "%s\n", error.c_str());
+      return false;
+    }
+
+    if (options.function_addresses.empty()) {
+      cfgs = std::move(file_cfgs);
+    } else {
+      // Only keep the selected functions
+      for (const uint64_t address : options.function_addresses) {
+        const auto it = std::find_if(
+            std::begin(file_cfgs), std::end(file_cfgs),
+            [address](const triton_bn::ControlFlowGraph& cfg) {
+              return cfg.function_start == address;
+            });
+        if (it == std::end(file_cfgs)) {
+          std::fprintf(stderr, "Function 0x%llx isn't part of '%s'\n",
+                       static_cast<unsigned long long>(address),
+                       options.cfg_path.c_str());
+          return false;
+        }
+        cfgs.emplace_back(std::move(*it));
+        file_cfgs.erase(it);
+      }
+    }
+  } else {
+    // Note: CFGs without basic blocks are recovered before being simplified
+    for (const uint64_t address : options.function_addresses) {
+      triton_bn::ControlFlowGraph cfg{};
+      cfg.function_start = address;
+      cfgs.emplace_back(std::move(cfg));
+    }
+  }
+
+  // Note: Standalone basic blocks are treated as single-block functions
+  for (const BlockRange& range : options.block_ranges) {
+    triton_bn::ControlFlowGraph cfg{};
+    cfg.function_start = range.start;
+    cfg.AddBasicBlock(range.start, range.end);
+    cfgs.emplace_back(std::move(cfg));
+  }
+
+  if (cfgs.empty()) {
+    std::fprintf(stderr,
+                 "Nothing to simplify, use --cfg, --function or --block\n");
+    return false;
+  }
+
+  return true;
+}
+
+// Simplify the given functions in parallel, the same way the plugin's
+// "Simplify all functions" command does (see `triton_bn::SimplifyFunctions`)
+static std::vector<std::vector<triton_bn::MetaBasicBlock>> SimplifyFunctions(
+    const CliOptions& options, const triton_bn::BinaryImage& image,
+    std::vector<triton_bn::ControlFlowGraph>& cfgs,
+    std::vector<FunctionResult>& results) {
+  using namespace triton_bn;
+
+  FunctionBatchOptions batch_options{};
+  batch_options.worker_count = options.worker_count;
+  batch_options.merge_basic_blocks = options.merge_basic_blocks;
+  batch_options.cross_block_liveness = options.cross_block_liveness;
+  SimplificationOptions& simplification_options = batch_options.simplification;
+  simplification_options.padding = true;
+  simplification_options.budget = options.budget;
+  simplification_options.max_rounds = options.max_rounds;
+  if (options.memory_ceiling_mib != 0) {
+    AstMemoryGovernor& memory_governor = AstMemoryGovernor::Instance();
+    memory_governor.SetCeiling(options.memory_ceiling_mib << 20);
+    simplification_options.memory_governor = &memory_governor;
+  }
+
+  results.assign(cfgs.size(), {});
+  FunctionBatchCallbacks callbacks{};
+  callbacks.on_extracted =
+      [&results](size_t i, const std::vector<MetaBasicBlock>& basic_blocks) {
+        for (const auto& meta_bb : basic_blocks) {
+          results[i].instruction_count_in += meta_bb.triton_bb().getSize();
+        }
+      };
+  auto simplified_functions = triton_bn::SimplifyFunctions(
+      image.code(), image.architecture(), cfgs, batch_options, callbacks);
+
+  for (size_t i = 0; i < cfgs.size(); i++) {
+    FunctionResult& result = results[i];
+    result.basic_block_count = cfgs[i].block_count();
+    result.simplified = !simplified_functions[i].empty();
+    for (auto& meta_bb : simplified_functions[i]) {
+      result.instruction_count_out += meta_bb.triton_bb().getSize();
+      if (meta_bb.over_budget()) {
+        result.over_budget_blocks.push_back(meta_bb.GetStart());
+      }
+    }
+  }
+
+  return simplified_functions;
+}
+
+// Copy the input file and apply the patches to the copy
+static bool WritePatchedImage(const CliOptions& options,
+                              const triton_bn::BinaryImage& image,
+                              const std::vector<triton_bn::Patch>& patches) {
+  std::error_code error_code{};
+  std::filesystem::copy_file(options.input_path, options.output_path,
+                             std::filesystem::copy_options::overwrite_existing,
+                             error_code);
+  if (error_code) {
+    std::fprintf(stderr, "Failed to create '%s': %s\n",
+                 options.output_path.c_str(), error_code.message().c_str());
+    return false;
+  }
+
+  std::fstream output(options.output_path,
+                      std::ios::in | std::ios::out | std::ios::binary);
+  bool success = static_cast<bool>(output);
+  for (const triton_bn::Patch& patch : patches) {
+    uint64_t file_offset = 0;
+    if (!image.AddressToFileOffset(patch.address, patch.data.size(),
+                                   file_offset)) {
+      std::fprintf(stderr, "Patch at 0x%llx isn't backed by the file\n",
+                   static_cast<unsigned long long>(patch.address));
+      success = false;
+      continue;
+    }
+
+    output.seekp(static_cast<std::streamoff>(file_offset));
+    output.write(reinterpret_cast<const char*>(patch.data.data()),
+                 static_cast<std::streamsize>(patch.data.size()));
+  }
+  if (!output) {
+    std::fprintf(stderr, "Failed to write '%s'\n",
+                 options.output_path.c_str());
+    return false;
+  }
+
+  return success;
+}
+
+// Note: Functions are listed in input order
+static bool WriteResults(const CliOptions& options,
+                         const triton_bn::BinaryImage& image,
+                         const std::vector<triton_bn::ControlFlowGraph>& cfgs,
+                         const std::vector<FunctionResult>& results,
+                         const triton_bn::PatchStatistics& patch_statistics) {
+  json document{};
+  document["schema_version"] = kResultSchemaVersion;
+  document["input"] = options.input_path;
+  document["architecture"] =
+      triton_bn::GetArchitectureName(image.architecture());
+
+  json functions = json::array();
+  for (size_t i = 0; i < results.size(); i++) {
+    const FunctionResult& result = results[i];
+    functions.push_back({
+        {"start", cfgs[i].function_start},
+        {"status", result.simplified ? "simplified" : "failed"},
+        {"basic_blocks", result.basic_block_count},
+        {"instructions_in", result.instruction_count_in},
+        {"instructions_out", result.instruction_count_out},
+        {"over_budget_basic_blocks", result.over_budget_blocks},
+    });
+  }
+  document["functions"] = std::move(functions);
+  document["patches"] = {
+      {"changed_bytes", patch_statistics.changed_byte_count},
+      {"writes", patch_statistics.write_count},
+  };
+  if (options.memory_ceiling_mib != 0) {
+    document["memory"] = {
+        {"ceiling_mib", options.memory_ceiling_mib},
+        {"peak_symbolic_state_bytes",
+         triton_bn::AstMemoryGovernor::Instance().peak_usage()},
+    };
+  }
+  if (options.instrumentation) {
+    document["instrumentation"] =
+        json::parse(triton_bn::Instrumentation::Instance().GenerateJson());
+  }
+
+  std::ofstream output(options.results_path);
+  output << document.dump(2) << "\n";
+  if (!output) {
+    std::fprintf(stderr, "Failed to write results to '%s'\n",
+                 options.results_path.c_str());
+    return false;
+  }
+
+  return true;
+}